@@ -0,0 +1,43 @@
+/** @file ClusterKernels.h
+ *  @brief Function prototypes for ClusterKernels.
+ *
+ *  This contains the prototypes for batch
+ *  cluster Et and eta-phi grid binning kernels.
+ *  Clusters are given as arrays.
+ *
+ *  @author Yakov Kulinich
+ *  @bug No known bugs.
+ */
+
+#ifndef CLUSTERANALYSIS_CLUSTERKERNELS_H
+#define CLUSTERANALYSIS_CLUSTERKERNELS_H
+
+#include <cstddef>
+
+namespace ClusterAnalysis{
+
+  class EtGrid;
+
+  namespace ClusterKernels{
+
+    // last argument false forces the scalar kernels, e.g. for
+    // validation. SIMD is chosen at build time, as for (and
+    // reported by) YKAnalysis::Kinematics
+
+    // et[i] = e[i] / cosh( eta[i] )
+    void EtBatch      ( const float*, const float*, std::size_t, float*, bool useSIMD = true );
+
+    // flat EtGrid index of (eta[i],phi[i]), -1 if outside grid
+    void GridBinBatch ( const EtGrid&, const float*, const float*, std::size_t, int*,
+			bool useSIMD = true );
+
+    // Et weighted flow vectors, harmonics 1..nHarmonics, added to
+    // qx/qy[ slice[i] * nHarmonics + n - 1 ]. slice -1 is skipped
+    void QVectorBatch ( const float*, const float*, const int*, std::size_t,
+			int, double*, double*, bool useSIMD = true );
+
+  }
+
+}
+
+#endif
@@ -0,0 +1,72 @@
+/** @file EtCorrelation.h
+ *  @brief Function prototypes for EtCorrelation.
+ *
+ *  This contains the prototypes and members
+ *  for EtCorrelation.
+ *
+ *  @author Yakov Kulinich
+ *  @bug No known bugs.
+ */
+
+#ifndef CLUSTERANALYSIS_ETCORRELATION_H
+#define CLUSTERANALYSIS_ETCORRELATION_H
+
+#include "ClusterAnalysis/FFT.h"
+
+#include <complex>
+#include <vector>
+
+class TH1D;
+class TH2D;
+
+namespace YKAnalysis{
+  class SharedData;
+}
+
+namespace ClusterAnalysis{
+
+  class EtGrid;
+
+  class EtCorrelation{
+  public:
+    EtCorrelation( const EtGrid&, const std::vector< double >& );
+    ~EtCorrelation();
+
+    // We do not want any copies of this class
+    EtCorrelation           ( const EtCorrelation& ) = delete ;
+    EtCorrelation& operator=( const EtCorrelation& ) = delete ;
+
+    void Register ( YKAnalysis::SharedData* );
+
+    void Fill     ( const EtGrid&, double );
+
+    int  GetNClasses () const { return m_v_powerSum.size(); }
+
+    // from (merged) sums, see makeEtCorrelation
+    static TH2D* Covariance ( const TH2D*, const TH2D*, double,
+			      const char*, const char* );
+
+  private:
+    int m_nEtaBins;
+    int m_nPhiBins;
+    // eta is zero padded so correlations do not wrap around in eta
+    int m_nEtaPad;
+
+    FFT m_fftEta;
+    FFT m_fftPhi;
+
+    std::vector< double > m_v_fcalEdges;
+
+    // per FCalEt class, additive so outputs can be hadd'ed
+    std::vector< TH2D* > m_v_powerSum;  // sum of |FFT|^2, nEtaPad x nPhi
+    std::vector< TH2D* > m_v_gridSum;   // sum of grids, nEta x nPhi
+    TH1D*                m_hNEvents;    // events per class
+
+    // nEtaPad x nPhi, phi contiguous
+    std::vector< std::complex< double > > m_v_work;
+
+    bool m_isRegistered;
+  };
+}
+
+#endif
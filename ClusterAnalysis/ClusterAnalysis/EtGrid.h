@@ -0,0 +1,122 @@
+/** @file EtGrid.h
+ *  @brief Function prototypes for EtGrid.
+ *
+ *  This contains the prototypes and members
+ *  for EtGrid.
+ *
+ *  @author Yakov Kulinich
+ *  @bug No known bugs.
+ */
+
+#ifndef CLUSTERANALYSIS_ETGRID_H
+#define CLUSTERANALYSIS_ETGRID_H
+
+#include "ClusterAnalysis/FixedBinning.h"
+
+#include <vector>
+#include <cstddef>
+
+namespace ClusterAnalysis{
+
+  class EtGrid{
+  public:
+    EtGrid();
+    EtGrid( int, double, double, int, double, double );
+    ~EtGrid();
+
+    // We do not want any copies of this class
+    EtGrid           ( const EtGrid& ) = delete ;
+    EtGrid& operator=( const EtGrid& ) = delete ;
+
+    void Clear ();
+
+    // same as TAxis::FindBin, 0 underflow, n+1 overflow
+    inline int FindEtaBin ( double eta ) const;
+    inline int FindPhiBin ( double phi ) const;
+
+    inline void Fill ( double, double, double );
+
+    // scatter-add of precomputed flat indices, -1 is outside
+    void FillBins ( const int*, const float*, std::size_t );
+
+    // bins start at 1, like TH2
+    double GetBinContent ( int xbin, int ybin ) const
+    { return m_content[ ( xbin - 1 ) * m_nPhiBins + ( ybin - 1 ) ]; }
+
+    // row of nPhiBins values for one eta bin
+    const double* GetEtaRow ( int xbin ) const
+    { return &m_content[ ( xbin - 1 ) * m_nPhiBins ]; }
+    double*       GetEtaRow ( int xbin )
+    { return &m_content[ ( xbin - 1 ) * m_nPhiBins ]; }
+
+    int    GetNEtaBins () const { return m_nEtaBins; }
+    int    GetNPhiBins () const { return m_nPhiBins; }
+    double GetEtaMin   () const { return m_etaMin; }
+    double GetEtaMax   () const { return m_etaMax; }
+    double GetPhiMin   () const { return m_phiMin; }
+    double GetPhiMax   () const { return m_phiMax; }
+
+    unsigned long GetNOutside () const { return m_nOutside; }
+
+    // max |difference| of any bin
+    double MaxAbsDiff ( const EtGrid& ) const;
+
+  private:
+    int    m_nEtaBins;
+    double m_etaMin, m_etaMax;
+    int    m_nPhiBins;
+    double m_phiMin, m_phiMax;
+
+    // eta major, phi contiguous
+    std::vector< double > m_content;
+
+    // entries that fell in under/overflow and were dropped
+    unsigned long m_nOutside;
+  };
+
+  /** @brief Find eta bin
+   *
+   *  @param1 eta
+   *
+   *  @return bin, 0 underflow, nEtaBins+1 overflow
+   */
+  inline int EtGrid :: FindEtaBin ( double eta ) const
+  {
+    return FindFixedBin( eta, m_nEtaBins, m_etaMin, m_etaMax );
+  }
+
+  /** @brief Find phi bin
+   *
+   *  @param1 phi
+   *
+   *  @return bin, 0 underflow, nPhiBins+1 overflow
+   */
+  inline int EtGrid :: FindPhiBin ( double phi ) const
+  {
+    return FindFixedBin( phi, m_nPhiBins, m_phiMin, m_phiMax );
+  }
+
+  /** @brief Add weight at (eta,phi)
+   *
+   *  Entries outside the grid are counted and dropped.
+   *
+   *  @param1 eta
+   *  @param2 phi
+   *  @param3 weight
+   *
+   *  @return void
+   */
+  inline void EtGrid :: Fill ( double eta, double phi, double w )
+  {
+    int xbin = FindEtaBin( eta );
+    int ybin = FindPhiBin( phi );
+    if( xbin < 1 || xbin > m_nEtaBins || ybin < 1 || ybin > m_nPhiBins ){
+      m_nOutside++;
+      return;
+    }
+    m_content[ ( xbin - 1 ) * m_nPhiBins + ( ybin - 1 ) ] += w;
+  }
+
+}
+
+#endif
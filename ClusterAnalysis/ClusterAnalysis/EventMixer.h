@@ -0,0 +1,70 @@
+/** @file EventMixer.h
+ *  @brief Function prototypes for EventMixer.
+ *
+ *  This contains the prototypes and members
+ *  for EventMixer.
+ *
+ *  @author Yakov Kulinich
+ *  @bug No known bugs.
+ */
+
+#ifndef CLUSTERANALYSIS_EVENTMIXER_H
+#define CLUSTERANALYSIS_EVENTMIXER_H
+
+#include <TRandom3.h>
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+namespace ClusterAnalysis{
+
+  class EtGrid;
+
+  class EventMixer{
+  public:
+    EventMixer( const EtGrid&, const std::vector< double >&, int );
+    ~EventMixer();
+
+    // We do not want any copies of this class
+    EventMixer           ( const EventMixer& ) = delete ;
+    EventMixer& operator=( const EventMixer& ) = delete ;
+
+    int  FindClass ( double ) const;
+
+    void Add       ( const EtGrid&, int );
+    bool IsFull    ( int c ) const { return c >= 0 && m_v_nStored[c] == m_depth; }
+    void MakeMixed ( int, EtGrid& );
+
+    int         GetNClasses () const { return m_v_nStored.size(); }
+    int         GetDepth    () const { return m_depth; }
+    std::size_t GetNBytes   () const { return m_pool.size() * sizeof( float ); }
+
+    void Print ( const std::string& ) const;
+
+  private:
+    // grid of event slot of class, nEta x nPhi, phi contiguous
+    float* Slot ( int c, int slot )
+    { return &m_pool[ ( std::size_t( c ) * m_depth + slot ) * m_gridSize ]; }
+
+    int m_nEtaBins;
+    int m_nPhiBins;
+    int m_gridSize;
+    int m_depth;
+
+    std::vector< double > m_v_fcalEdges;
+
+    // all grids, allocated once, nClasses x depth x grid
+    std::vector< float > m_pool;
+
+    // per FCalEt class, ring buffer
+    std::vector< int >  m_v_next;
+    std::vector< int >  m_v_nStored;
+    std::vector< long > m_v_nAdded;
+    std::vector< long > m_v_nMixed;
+
+    TRandom3 m_random;
+  };
+}
+
+#endif
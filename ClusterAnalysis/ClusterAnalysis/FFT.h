@@ -0,0 +1,50 @@
+/** @file FFT.h
+ *  @brief Function prototypes for FFT.
+ *
+ *  This contains the prototypes and members
+ *  for FFT.
+ *
+ *  @author Yakov Kulinich
+ *  @bug No known bugs.
+ */
+
+#ifndef CLUSTERANALYSIS_FFT_H
+#define CLUSTERANALYSIS_FFT_H
+
+#include <complex>
+#include <vector>
+#include <cstddef>
+
+namespace ClusterAnalysis{
+
+  class FFT{
+  public:
+    FFT( std::size_t );
+    ~FFT();
+
+    // in place, n values spaced by stride
+    void Forward ( std::complex< double >*, std::size_t stride = 1 ) const;
+    // in place, includes 1/n
+    void Inverse ( std::complex< double >*, std::size_t stride = 1 ) const;
+
+    std::size_t GetN () const { return m_n; }
+
+    static bool IsPowerOfTwo ( std::size_t n ) { return n && !( n & ( n - 1 ) ); }
+
+  private:
+    void Transform ( std::complex< double >*, std::size_t, bool ) const;
+
+    std::size_t m_n;
+
+    // exp( -2 pi i k / n ), k < n/2
+    std::vector< std::complex< double > > m_v_twiddle;
+    // bit reversed index
+    std::vector< std::size_t >            m_v_reverse;
+
+    // for strided input
+    mutable std::vector< std::complex< double > > m_v_scratch;
+  };
+
+}
+
+#endif
@@ -0,0 +1,36 @@
+/** @file FixedBinning.h
+ *  @brief Bin lookup for fixed width binning.
+ *
+ *  Same operations as TAxis::FindBin for an axis with
+ *  uniform bins, so bins found here and by the histograms
+ *  are identical. Used by EtGrid, HistFillBuffer and the
+ *  scalar ClusterKernels.
+ *
+ *  @author Yakov Kulinich
+ *  @bug No known bugs.
+ */
+
+#ifndef CLUSTERANALYSIS_FIXEDBINNING_H
+#define CLUSTERANALYSIS_FIXEDBINNING_H
+
+namespace ClusterAnalysis{
+
+  /** @brief Find bin, same as TAxis::FindBin
+   *
+   *  @param1 value
+   *  @param2 number of bins
+   *  @param3 low edge
+   *  @param4 high edge
+   *
+   *  @return bin, 0 underflow, n+1 overflow
+   */
+  inline int FindFixedBin ( double x, int n, double min, double max )
+  {
+    if( x < min ) return 0;
+    if( !( x < max ) ) return n + 1;
+    return 1 + int( n * ( x - min ) / ( max - min ) );
+  }
+
+}
+
+#endif
@@ -14,7 +14,21 @@
 #include "YKAnalysis/Global.h"
 #include "YKAnalysis/Analysis.h"
 
+#include "ClusterAnalysis/WindowStats.h"
+
+class TTree;
+
+namespace YKAnalysis{
+  class TDigest;
+}
+
 namespace ClusterAnalysis{
+
+  class EtGrid;
+  class WindowSumTable;
+  class HistFillBuffer;
+  class EtCorrelation;
+  class EventMixer;
   
   class FluctuationAnalysis : public YKAnalysis::Analysis{
   public:
@@ -31,31 +45,110 @@ namespace ClusterAnalysis{
     virtual xAOD::TReturnCode Finalize       ();
     virtual xAOD::TReturnCode HistFinalize   ();
 
-    double AnalyzeFluctuations
-      ( TH2D*, double );
-    double AnalyzeFluctuationsEtaSlices 
-      ( TH2D*, double, std::vector<double>&, TH3D* );
+    virtual void OnAutoSave ();
+
+    xAOD::TReturnCode FillFlowVectors
+      ( std::size_t );
+    void   GetEtaBinRange
+      ( double, int&, int& );
+    void   AnalyzeWindowRow
+      ( const WindowSumTable*, int, int, int, bool, HistFillBuffer*, WindowStats& );
+    void   AnalyzeFluctuations
+      ( const WindowSumTable*, int, int, bool,
+	std::vector<double>&, std::vector<double>*, HistFillBuffer* );
    
   private:
     // For tree
     double m_FCalEt;
     std::vector< double > m_v_caloFluctuations;
     std::vector< double > m_v_caloFluctuationEtaSlices;
+    // [window size][eta limit]
+    std::vector< std::vector< double > > m_v_caloFluctuationsBySize;
+    // mixed events, empty until the class buffer is full
+    std::vector< double > m_v_caloFluctuationsMixed;
+    std::vector< double > m_v_caloFluctuationEtaSlicesMixed;
+    // flow vectors, [slice][harmonic] flattened
+    std::vector< float > m_v_qnClusterX;
+    std::vector< float > m_v_qnClusterY;
+    std::vector< float > m_v_qnClusterSumEt;
+    std::vector< float > m_v_qnFCalX;
+    std::vector< float > m_v_qnFCalY;
+    std::vector< float > m_v_qnFCalSumEt;
     
     // Histograms
     TH3D* h3_EtaFCalEtWindowEt;
+    // fills of h3_EtaFCalEtWindowEt go through this
+    HistFillBuffer* m_h3FillBuffer;
+    int m_fillBufferSize;
     
     TH1D* h1_FCalEt;
 
     std::string m_clusterContainerName;
+
+    // Et by (eta,phi), reused every event
+    EtGrid*         m_etGrid;
+    // scalar reference grid, only when validating
+    EtGrid*         m_etGridReference;
+    WindowSumTable* m_windowSumTable;
+
+    // FCalEt classes (TeV)
+    std::vector< double > m_v_fcalEtClasses;
+
+    bool           m_doEtCorrelation;
+    EtCorrelation* m_etCorrelation;
+
+    // FCalEt quantiles, for centrality
+    bool                 m_doFCalEtDigest;
+    double               m_fcalEtDigestCompression;
+    YKAnalysis::TDigest* m_fcalEtDigest;
+    TTree*               m_fcalEtDigestTree;
+
+    // mixed events, per FCalEt class
+    bool        m_doEventMixing;
+    int         m_mixingDepth;
+    EventMixer* m_eventMixer;
+    EtGrid*     m_etGridMixed;
+
+    // statistics per row of windows, by eta corner bin
+    std::vector< WindowStats > m_v_rowStats;
+    std::vector< bool >        m_v_rowDone;
     
-    // etacut
+    // etacut, ascending
     std::vector< double >  m_v_etaLimits;
     
     // fluctuation window
     int m_window_Eta_size;
     int m_window_Phi_size;
 
+    // clusters of this event, as arrays
+    std::vector< float > m_v_clusterEta;
+    std::vector< float > m_v_clusterPhi;
+    std::vector< float > m_v_clusterE;
+    std::vector< float > m_v_clusterEt;
+    std::vector< int >   m_v_clusterBin;
+    std::vector< int >   m_v_clusterSlice;
+
+    // flow vectors
+    bool m_doFlowVectors;
+    int  m_nHarmonics;
+    int  m_qnEtaBinsPerSlice;
+    int  m_nQnSlices;
+    std::vector< double > m_v_qnSumX;
+    std::vector< double > m_v_qnSumY;
+    std::vector< double > m_v_qnSumEt;
+    // scalar q-vectors, when validating
+    std::vector< double > m_v_qnRefX;
+    std::vector< double > m_v_qnRefY;
+
+    bool   m_useSIMD;
+    bool   m_validateSIMD;
+    double m_maxValidationDiff;
+    double m_maxQnValidationDiff;
+
+    // extra (square) window sizes to study
+    std::vector< int > m_v_windowSizes;
+    bool m_slidingWindows;
+
     // for binning
     double m_etaMin, m_etaMax, m_phiMin, m_phiMax;
     double m_fCalEtMin, m_fCalEtMax;
@@ -0,0 +1,125 @@
+/** @file HistFillBuffer.h
+ *  @brief Function prototypes for HistFillBuffer.
+ *
+ *  This contains the prototypes and members
+ *  for HistFillBuffer.
+ *
+ *  @author Yakov Kulinich
+ *  @bug No known bugs.
+ */
+
+#ifndef CLUSTERANALYSIS_HISTFILLBUFFER_H
+#define CLUSTERANALYSIS_HISTFILLBUFFER_H
+
+#include "ClusterAnalysis/FixedBinning.h"
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+class TH3D;
+class TAxis;
+
+namespace ClusterAnalysis{
+
+  class HistFillBuffer{
+  public:
+    HistFillBuffer( TH3D*, std::size_t );
+    ~HistFillBuffer();
+
+    // We do not want any copies of this class
+    HistFillBuffer           ( const HistFillBuffer& ) = delete ;
+    HistFillBuffer& operator=( const HistFillBuffer& ) = delete ;
+
+    // same as TAxis::FindBin for fixed binning
+    int FindBinX ( double x ) const { return m_xAxis.FindBin( x ); }
+    int FindBinY ( double y ) const { return m_yAxis.FindBin( y ); }
+    int FindBinZ ( double z ) const { return m_zAxis.FindBin( z ); }
+
+    inline void Fill ( int, int, double, double, double, double w = 1 );
+
+    void Flush ();
+
+    std::size_t GetNBuffered () const { return m_v_bin.size(); }
+
+    void Print ( const std::string& ) const;
+
+  private:
+    struct Axis{
+      int    nBins;
+      double min, max;
+
+      void Set ( const TAxis* );
+      int  FindBin ( double x ) const { return FindFixedBin( x, nBins, min, max ); }
+      bool InRange ( int bin ) const { return bin >= 1 && bin <= nBins; }
+    };
+
+    void LoadStats ();
+
+    // not owned
+    TH3D* m_hist;
+
+    Axis m_xAxis, m_yAxis, m_zAxis;
+
+    std::size_t m_capacity;
+    bool        m_statOverflows;
+
+    // global bin and weight of each buffered fill
+    std::vector< int >    m_v_bin;
+    std::vector< double > m_v_w;
+
+    // TH3 statistics (see TH3::GetStats), continued from histogram
+    double m_stats[ 11 ];
+    bool   m_statsLoaded;
+
+    unsigned long m_nFlushes;
+    unsigned long m_nFills;
+  };
+
+  /** @brief Buffer one fill
+   *
+   *  Same as TH3::Fill( x, y, z, w ), with x and y bins
+   *  already known. Statistics are accumulated in
+   *  the same order as TH3::Fill would.
+   *
+   *  @param1 x bin
+   *  @param2 y bin
+   *  @param3 x
+   *  @param4 y
+   *  @param5 z
+   *  @param6 weight
+   *
+   *  @return void
+   */
+  inline void HistFillBuffer :: Fill ( int binx, int biny, double x, double y, double z, double w )
+  {
+    if( !m_statsLoaded ) LoadStats();
+    
+    int binz = m_zAxis.FindBin( z );
+    int bin  = binx + ( m_xAxis.nBins + 2 ) * ( biny + ( m_yAxis.nBins + 2 ) * binz );
+
+    m_v_bin.push_back( bin );
+    m_v_w  .push_back( w   );
+    m_nFills++;
+
+    if( m_statOverflows ||
+	( m_xAxis.InRange( binx ) && m_yAxis.InRange( biny ) && m_zAxis.InRange( binz ) ) ){
+      m_stats[ 0] += w;
+      m_stats[ 1] += w*w;
+      m_stats[ 2] += w*x;
+      m_stats[ 3] += w*x*x;
+      m_stats[ 4] += w*y;
+      m_stats[ 5] += w*y*y;
+      m_stats[ 6] += w*x*y;
+      m_stats[ 7] += w*z;
+      m_stats[ 8] += w*z*z;
+      m_stats[ 9] += w*x*z;
+      m_stats[10] += w*y*z;
+    }
+
+    if( m_v_bin.size() >= m_capacity ) Flush();
+  }
+
+}
+
+#endif
@@ -0,0 +1,55 @@
+/** @file WindowStats.h
+ *  @brief Function prototypes for WindowStats.
+ *
+ *  This contains the prototypes and members
+ *  for WindowStats.
+ *
+ *  @author Yakov Kulinich
+ *  @bug No known bugs.
+ */
+
+#ifndef CLUSTERANALYSIS_WINDOWSTATS_H
+#define CLUSTERANALYSIS_WINDOWSTATS_H
+
+#include <cmath>
+
+namespace ClusterAnalysis{
+
+  class WindowStats{
+  public:
+    WindowStats() : m_n( 0 ), m_mean( 0 ), m_m2( 0 ) {}
+
+    void Clear () { m_n = 0; m_mean = 0; m_m2 = 0; }
+
+    inline void Add   ( double );
+    void        Merge ( const WindowStats& );
+
+    long   GetN       () const { return m_n; }
+    double GetMean    () const { return m_mean; }
+    // population standard deviation, NaN if empty
+    double GetStdDev  () const { return std::sqrt( m_m2 / m_n ); }
+
+  private:
+    long   m_n;
+    double m_mean;
+    // sum of squared deviations from mean
+    double m_m2;
+  };
+
+  /** @brief Add one window (Welford update)
+   *
+   *  @param1 window Et
+   *
+   *  @return void
+   */
+  inline void WindowStats :: Add ( double x )
+  {
+    m_n++;
+    double delta = x - m_mean;
+    m_mean += delta / m_n;
+    m_m2   += delta * ( x - m_mean );
+  }
+
+}
+
+#endif
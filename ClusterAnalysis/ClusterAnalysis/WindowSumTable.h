@@ -0,0 +1,81 @@
+/** @file WindowSumTable.h
+ *  @brief Function prototypes for WindowSumTable.
+ *
+ *  This contains the prototypes and members
+ *  for WindowSumTable.
+ *
+ *  @author Yakov Kulinich
+ *  @bug No known bugs.
+ */
+
+#ifndef CLUSTERANALYSIS_WINDOWSUMTABLE_H
+#define CLUSTERANALYSIS_WINDOWSUMTABLE_H
+
+#include <vector>
+
+namespace ClusterAnalysis{
+
+  class EtGrid;
+
+  class WindowSumTable{
+  public:
+    WindowSumTable();
+    ~WindowSumTable();
+
+    // We do not want any copies of this class
+    WindowSumTable           ( const WindowSumTable& ) = delete ;
+    WindowSumTable& operator=( const WindowSumTable& ) = delete ;
+
+    void Build ( const EtGrid& );
+
+    inline double GetWindowSum ( int, int, int, int ) const;
+
+    int GetNEtaBins () const { return m_nEtaBins; }
+    int GetNPhiBins () const { return m_nPhiBins; }
+
+  private:
+    // sum of bins [1,xbin] x [1,ybin], 0 if either is 0
+    double At ( int xbin, int ybin ) const
+    { return m_sum[ xbin * ( m_nPhiBins + 1 ) + ybin ]; }
+
+    int m_nEtaBins;
+    int m_nPhiBins;
+
+    // (nEta+1) x (nPhi+1), first row and column are 0
+    std::vector< double > m_sum;
+  };
+
+  /** @brief Sum of a window
+   *
+   *  Window covers eta bins [xbin, xbin+etaSize) and
+   *  phi bins [ybin, ybin+phiSize), phi wraps around.
+   *  Bins start at 1. Eta range must be inside the grid,
+   *  phiSize must not be larger than the number of phi bins.
+   *
+   *  @param1 first eta bin
+   *  @param2 first phi bin
+   *  @param3 eta size (bins)
+   *  @param4 phi size (bins)
+   *
+   *  @return sum of window
+   */
+  inline double WindowSumTable :: GetWindowSum ( int xbin, int ybin, int etaSize, int phiSize ) const
+  {
+    int x0 = xbin - 1;
+    int x1 = x0 + etaSize;
+    int y0 = ybin - 1;
+    int y1 = y0 + phiSize;
+
+    if( y1 <= m_nPhiBins )
+      return At( x1, y1 ) - At( x0, y1 ) - At( x1, y0 ) + At( x0, y0 );
+
+    // wraps around in phi, [y0,nPhi] + [0,y1-nPhi]
+    y1 -= m_nPhiBins;
+    return
+      At( x1, m_nPhiBins ) - At( x0, m_nPhiBins ) - At( x1, y0 ) + At( x0, y0 ) +
+      At( x1, y1         ) - At( x0, y1 );
+  }
+
+}
+
+#endif
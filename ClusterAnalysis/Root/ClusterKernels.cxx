@@ -0,0 +1,337 @@
+/** @file ClusterKernels.cxx
+ *  @brief Implementation of ClusterKernels.
+ *
+ *  Batch Et and eta-phi grid binning of clusters stored
+ *  as structure-of-arrays, so the SSE2 kernels can work on
+ *  four clusters at a time. 
+ *
+ *  Et uses a polynomial exp (Cephes expf, about 1 ulp) for
+ *  cosh, in float. The scalar kernel uses std::exp and is
+ *  used for the tail, when SIMD is not built, or when the
+ *  caller passes useSIMD = false.
+ *
+ *  Grid bins are computed in double with the same operations
+ *  as TAxis::FindBin, so SIMD and scalar bins are identical.
+ *
+ *  Flow vectors use sin and cos of phi once per cluster
+ *  (Cephes sincosf in SSE2) and the Chebyshev recurrences
+ *    cos((n+1)x) = 2 cos(x) cos(nx) - cos((n-1)x)
+ *    sin((n+1)x) = 2 cos(x) sin(nx) - sin((n-1)x)
+ *  for the higher harmonics, in float. Sums are in double.
+ *
+ *  @author Yakov Kulinich
+ *  @bug No known bugs.
+ */
+
+#include "ClusterAnalysis/ClusterKernels.h"
+#include "ClusterAnalysis/EtGrid.h"
+#include "ClusterAnalysis/FixedBinning.h"
+
+#include <cmath>
+
+#if defined(__SSE2__) && !defined(YKANALYSIS_NO_SIMD)
+#define YKANALYSIS_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+  void EtScalar( const float* eta, const float* e, std::size_t i, std::size_t n, float* et )
+  {
+    for( ; i < n; i++ ){
+      float a = std::exp( std::fabs( eta[i] ) );
+      et[i] = e[i] / ( 0.5f * ( a + 1.f / a ) );
+    }
+  }
+
+  void GridBinScalar( int nEta, double etaMin, double etaMax,
+		      int nPhi, double phiMin, double phiMax,
+		      const float* eta, const float* phi,
+		      std::size_t i, std::size_t n, int* bin )
+  {
+    for( ; i < n; i++ ){
+      int xbin = ClusterAnalysis::FindFixedBin( eta[i], nEta, etaMin, etaMax );
+      int ybin = ClusterAnalysis::FindFixedBin( phi[i], nPhi, phiMin, phiMax );
+      bin[i] = ( xbin < 1 || xbin > nEta || ybin < 1 || ybin > nPhi ) ?
+	-1 : ( xbin - 1 ) * nPhi + ( ybin - 1 );
+    }
+  }
+
+  // max harmonic of the QVector kernels
+  const int s_maxHarmonics = 16;
+
+  void QVectorScalar( const float* phi, const float* w, const int* slice,
+		      std::size_t i, std::size_t n, int nHarmonics,
+		      double* qx, double* qy )
+  {
+    for( ; i < n; i++ ){
+      if( slice[i] < 0 ) continue;
+      double* sliceQx = qx + slice[i] * nHarmonics;
+      double* sliceQy = qy + slice[i] * nHarmonics;
+
+      float c1 = std::cos( phi[i] ), s1 = std::sin( phi[i] );
+      float cPrev = 1, sPrev = 0;
+      float c = c1, s = s1;
+      for( int k = 0; k < nHarmonics; k++ ){
+	sliceQx[k] += w[i] * c;
+	sliceQy[k] += w[i] * s;
+	float cNext = 2 * c1 * c - cPrev;
+	float sNext = 2 * c1 * s - sPrev;
+	cPrev = c; sPrev = s;
+	c = cNext; s = sNext;
+      }
+    }
+  }
+
+#ifdef YKANALYSIS_SSE2
+  // exp(x), four at a time. Cephes expf.
+  inline __m128 Exp4( __m128 x )
+  {
+    const __m128 vOne = _mm_set1_ps( 1.f );
+    
+    x = _mm_min_ps( x, _mm_set1_ps(  88.3762626647949f ) );
+    x = _mm_max_ps( x, _mm_set1_ps( -88.3762626647949f ) );
+
+    // exp(x) = 2^k exp(r), k = round( x / ln2 )
+    __m128 fx   = _mm_add_ps( _mm_mul_ps( x, _mm_set1_ps( 1.44269504088896341f ) ), _mm_set1_ps( 0.5f ) );
+    __m128 tmp  = _mm_cvtepi32_ps( _mm_cvttps_epi32( fx ) );
+    __m128 mask = _mm_and_ps( _mm_cmpgt_ps( tmp, fx ), vOne );
+    fx = _mm_sub_ps( tmp, mask );  // floor
+
+    x = _mm_sub_ps( x, _mm_mul_ps( fx, _mm_set1_ps(  0.693359375f    ) ) );
+    x = _mm_sub_ps( x, _mm_mul_ps( fx, _mm_set1_ps( -2.12194440e-4f ) ) );
+    __m128 z = _mm_mul_ps( x, x );
+
+    __m128 y = _mm_set1_ps( 1.9875691500E-4f );
+    y = _mm_add_ps( _mm_mul_ps( y, x ), _mm_set1_ps( 1.3981999507E-3f ) );
+    y = _mm_add_ps( _mm_mul_ps( y, x ), _mm_set1_ps( 8.3334519073E-3f ) );
+    y = _mm_add_ps( _mm_mul_ps( y, x ), _mm_set1_ps( 4.1665795894E-2f ) );
+    y = _mm_add_ps( _mm_mul_ps( y, x ), _mm_set1_ps( 1.6666665459E-1f ) );
+    y = _mm_add_ps( _mm_mul_ps( y, x ), _mm_set1_ps( 5.0000001201E-1f ) );
+    y = _mm_add_ps( _mm_add_ps( _mm_mul_ps( y, z ), x ), vOne );
+
+    // 2^k
+    __m128i k = _mm_cvttps_epi32( fx );
+    k = _mm_slli_epi32( _mm_add_epi32( k, _mm_set1_epi32( 0x7f ) ), 23 );
+    return _mm_mul_ps( y, _mm_castsi128_ps( k ) );
+  }
+
+  // sin(x) and cos(x), four at a time. Cephes sincosf.
+  inline void SinCos4( __m128 x, __m128* sinOut, __m128* cosOut )
+  {
+    const __m128  vSign  = _mm_castsi128_ps( _mm_set1_epi32( 0x80000000 ) );
+    const __m128i vOne   = _mm_set1_epi32( 1 );
+    const __m128i vTwo   = _mm_set1_epi32( 2 );
+    const __m128i vFour  = _mm_set1_epi32( 4 );
+
+    __m128 signSin = _mm_and_ps   ( x, vSign );
+    x              = _mm_andnot_ps( vSign, x );
+
+    // octant, j even
+    __m128  y = _mm_mul_ps( x, _mm_set1_ps( 1.27323954473516f ) );  // 4 / pi
+    __m128i j = _mm_cvttps_epi32( y );
+    j = _mm_andnot_si128( vOne, _mm_add_epi32( j, vOne ) );
+    y = _mm_cvtepi32_ps( j );
+
+    __m128 swapSin  = _mm_castsi128_ps( _mm_slli_epi32( _mm_and_si128( j, vFour ), 29 ) );
+    __m128 polyMask = _mm_castsi128_ps( _mm_cmpeq_epi32( _mm_and_si128( j, vTwo ), _mm_setzero_si128() ) );
+    __m128 signCos  = _mm_castsi128_ps
+      ( _mm_slli_epi32( _mm_andnot_si128( _mm_sub_epi32( j, vTwo ), vFour ), 29 ) );
+    signSin = _mm_xor_ps( signSin, swapSin );
+
+    // x - y * pi/4 in three parts
+    x = _mm_sub_ps( x, _mm_mul_ps( y, _mm_set1_ps( 0.78515625f ) ) );
+    x = _mm_sub_ps( x, _mm_mul_ps( y, _mm_set1_ps( 2.4187564849853515625e-4f ) ) );
+    x = _mm_sub_ps( x, _mm_mul_ps( y, _mm_set1_ps( 3.77489497744594108e-8f ) ) );
+    __m128 z = _mm_mul_ps( x, x );
+
+    // cos polynomial
+    __m128 yc = _mm_set1_ps( 2.443315711809948E-005f );
+    yc = _mm_add_ps( _mm_mul_ps( yc, z ), _mm_set1_ps( -1.388731625493765E-003f ) );
+    yc = _mm_add_ps( _mm_mul_ps( yc, z ), _mm_set1_ps(  4.166664568298827E-002f ) );
+    yc = _mm_mul_ps( _mm_mul_ps( yc, z ), z );
+    yc = _mm_sub_ps( yc, _mm_mul_ps( z, _mm_set1_ps( 0.5f ) ) );
+    yc = _mm_add_ps( yc, _mm_set1_ps( 1.f ) );
+
+    // sin polynomial
+    __m128 ys = _mm_set1_ps( -1.9515295891E-4f );
+    ys = _mm_add_ps( _mm_mul_ps( ys, z ), _mm_set1_ps(  8.3321608736E-3f ) );
+    ys = _mm_add_ps( _mm_mul_ps( ys, z ), _mm_set1_ps( -1.6666654611E-1f ) );
+    ys = _mm_add_ps( _mm_mul_ps( _mm_mul_ps( ys, z ), x ), x );
+
+    __m128 s = _mm_or_ps( _mm_and_ps( polyMask, ys ), _mm_andnot_ps( polyMask, yc ) );
+    __m128 c = _mm_or_ps( _mm_and_ps( polyMask, yc ), _mm_andnot_ps( polyMask, ys ) );
+    *sinOut = _mm_xor_ps( s, signSin );
+    *cosOut = _mm_xor_ps( c, signCos );
+  }
+
+  // FindBin of two doubles, returned in the low two ints
+  inline __m128i FindBin2( __m128d x, __m128d vN, __m128d vMin, __m128d vMax, __m128d vRange,
+			   __m128i vUnder, __m128i vOver )
+  {
+    __m128i bin   = _mm_cvttpd_epi32( _mm_div_pd( _mm_mul_pd( vN, _mm_sub_pd( x, vMin ) ), vRange ) );
+    bin           = _mm_add_epi32( bin, _mm_set1_epi32( 1 ) );
+    // cmp results are 64 bit, keep one 32 bit word of each
+    __m128i under = _mm_shuffle_epi32( _mm_castpd_si128( _mm_cmplt_pd( x, vMin ) ), _MM_SHUFFLE( 3, 3, 2, 0 ) );
+    __m128i over  = _mm_shuffle_epi32( _mm_castpd_si128( _mm_cmpnlt_pd( x, vMax ) ), _MM_SHUFFLE( 3, 3, 2, 0 ) );
+    bin = _mm_or_si128( _mm_andnot_si128( under, bin ), _mm_and_si128( under, vUnder ) );
+    bin = _mm_or_si128( _mm_andnot_si128( over,  bin ), _mm_and_si128( over,  vOver  ) );
+    return bin;
+  }
+#endif
+
+}
+
+/** @brief Et of clusters
+ *
+ *  @param1 cluster etas
+ *  @param2 cluster energies
+ *  @param3 number of clusters
+ *  @param4 output Et, same units as energy
+ *  @param5 use SIMD kernels if built
+ *
+ *  @return void
+ */
+void ClusterAnalysis :: ClusterKernels :: EtBatch( const float* eta, const float* e,
+						   std::size_t n, float* et, bool useSIMD )
+{
+  std::size_t i = 0;
+#ifdef YKANALYSIS_SSE2
+  if( useSIMD ){
+    const __m128 vAbs  = _mm_castsi128_ps( _mm_set1_epi32( 0x7fffffff ) );
+    const __m128 vHalf = _mm_set1_ps( 0.5f );
+    const __m128 vOne  = _mm_set1_ps( 1.f  );
+    for( ; i + 4 <= n; i += 4 ){
+      __m128 a    = Exp4( _mm_and_ps( _mm_loadu_ps( eta + i ), vAbs ) );
+      __m128 cosh = _mm_mul_ps( vHalf, _mm_add_ps( a, _mm_div_ps( vOne, a ) ) );
+      _mm_storeu_ps( et + i, _mm_div_ps( _mm_loadu_ps( e + i ), cosh ) );
+    }
+  }
+#endif
+  EtScalar( eta, e, i, n, et );
+}
+
+/** @brief EtGrid bins of clusters
+ *
+ *  @param1 grid
+ *  @param2 cluster etas
+ *  @param3 cluster phis
+ *  @param4 number of clusters
+ *  @param5 output flat grid index, -1 if outside
+ *  @param6 use SIMD kernels if built
+ *
+ *  @return void
+ */
+void ClusterAnalysis :: ClusterKernels :: GridBinBatch( const EtGrid& grid,
+							const float* eta, const float* phi,
+							std::size_t n, int* bin, bool useSIMD )
+{
+  int    nEta   = grid.GetNEtaBins();
+  double etaMin = grid.GetEtaMin();
+  double etaMax = grid.GetEtaMax();
+  int    nPhi   = grid.GetNPhiBins();
+  double phiMin = grid.GetPhiMin();
+  double phiMax = grid.GetPhiMax();
+
+  std::size_t i = 0;
+#ifdef YKANALYSIS_SSE2
+  if( useSIMD ){
+    const __m128d vNEta      = _mm_set1_pd( nEta );
+    const __m128d vEtaMin    = _mm_set1_pd( etaMin );
+    const __m128d vEtaMax    = _mm_set1_pd( etaMax );
+    const __m128d vEtaRange  = _mm_set1_pd( etaMax - etaMin );
+    const __m128i vEtaOver   = _mm_set1_epi32( nEta + 1 );
+    const __m128d vNPhi      = _mm_set1_pd( nPhi );
+    const __m128d vPhiMin    = _mm_set1_pd( phiMin );
+    const __m128d vPhiMax    = _mm_set1_pd( phiMax );
+    const __m128d vPhiRange  = _mm_set1_pd( phiMax - phiMin );
+    const __m128i vPhiOver   = _mm_set1_epi32( nPhi + 1 );
+    const __m128i vZero      = _mm_setzero_si128();
+
+    int xbin[4], ybin[4];
+    for( ; i + 4 <= n; i += 4 ){
+      __m128 vEta = _mm_loadu_ps( eta + i );
+      __m128 vPhi = _mm_loadu_ps( phi + i );
+
+      __m128i xLo = FindBin2( _mm_cvtps_pd( vEta ),
+			      vNEta, vEtaMin, vEtaMax, vEtaRange, vZero, vEtaOver );
+      __m128i xHi = FindBin2( _mm_cvtps_pd( _mm_movehl_ps( vEta, vEta ) ),
+			      vNEta, vEtaMin, vEtaMax, vEtaRange, vZero, vEtaOver );
+      __m128i yLo = FindBin2( _mm_cvtps_pd( vPhi ),
+			      vNPhi, vPhiMin, vPhiMax, vPhiRange, vZero, vPhiOver );
+      __m128i yHi = FindBin2( _mm_cvtps_pd( _mm_movehl_ps( vPhi, vPhi ) ),
+			      vNPhi, vPhiMin, vPhiMax, vPhiRange, vZero, vPhiOver );
+
+      _mm_storeu_si128( reinterpret_cast< __m128i* >( xbin ), _mm_unpacklo_epi64( xLo, xHi ) );
+      _mm_storeu_si128( reinterpret_cast< __m128i* >( ybin ), _mm_unpacklo_epi64( yLo, yHi ) );
+
+      for( int j = 0; j < 4; j++ ){
+	bin[i+j] = ( xbin[j] < 1 || xbin[j] > nEta || ybin[j] < 1 || ybin[j] > nPhi ) ?
+	  -1 : ( xbin[j] - 1 ) * nPhi + ( ybin[j] - 1 );
+      }
+    }
+  }
+#endif
+  GridBinScalar( nEta, etaMin, etaMax, nPhi, phiMin, phiMax, eta, phi, i, n, bin );
+}
+
+/** @brief Et weighted flow vectors of clusters
+ *
+ *  Adds w cos(n phi) and w sin(n phi), n = 1..nHarmonics,
+ *  to the q-vectors of each cluster's slice.
+ *
+ *  @param1 cluster phis
+ *  @param2 cluster weights (Et)
+ *  @param3 cluster slices, -1 to skip
+ *  @param4 number of clusters
+ *  @param5 number of harmonics (at most 16)
+ *  @param6 qx, nSlices x nHarmonics, added to
+ *  @param7 qy, nSlices x nHarmonics, added to
+ *  @param8 use SIMD kernels if built
+ *
+ *  @return void
+ */
+void ClusterAnalysis :: ClusterKernels :: QVectorBatch( const float* phi, const float* w,
+							const int* slice, std::size_t n,
+							int nHarmonics, double* qx, double* qy,
+							bool useSIMD )
+{
+  if( nHarmonics > s_maxHarmonics ) nHarmonics = s_maxHarmonics;
+
+  std::size_t i = 0;
+#ifdef YKANALYSIS_SSE2
+  if( useSIMD ){
+    const __m128 vTwo = _mm_set1_ps( 2.f );
+    // w cos(n phi), w sin(n phi) of four clusters, by harmonic
+    float wc[ s_maxHarmonics ][4], ws[ s_maxHarmonics ][4];
+    for( ; i + 4 <= n; i += 4 ){
+      __m128 vW = _mm_loadu_ps( w + i );
+      __m128 s1, c1;
+      SinCos4( _mm_loadu_ps( phi + i ), &s1, &c1 );
+
+      __m128 twoC1 = _mm_mul_ps( vTwo, c1 );
+      __m128 cPrev = _mm_set1_ps( 1.f ), sPrev = _mm_setzero_ps();
+      __m128 c = c1, s = s1;
+      for( int k = 0; k < nHarmonics; k++ ){
+	_mm_storeu_ps( wc[k], _mm_mul_ps( vW, c ) );
+	_mm_storeu_ps( ws[k], _mm_mul_ps( vW, s ) );
+	__m128 cNext = _mm_sub_ps( _mm_mul_ps( twoC1, c ), cPrev );
+	__m128 sNext = _mm_sub_ps( _mm_mul_ps( twoC1, s ), sPrev );
+	cPrev = c; sPrev = s;
+	c = cNext; s = sNext;
+      }
+
+      for( int j = 0; j < 4; j++ ){
+	if( slice[i+j] < 0 ) continue;
+	double* sliceQx = qx + slice[i+j] * nHarmonics;
+	double* sliceQy = qy + slice[i+j] * nHarmonics;
+	for( int k = 0; k < nHarmonics; k++ ){
+	  sliceQx[k] += wc[k][j];
+	  sliceQy[k] += ws[k][j];
+	}
+      }
+    }
+  }
+#endif
+  QVectorScalar( phi, w, slice, i, n, nHarmonics, qx, qy );
+}
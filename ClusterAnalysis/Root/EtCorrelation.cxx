@@ -0,0 +1,265 @@
+/** @file EtCorrelation.cxx
+ *  @brief Implementation of EtCorrelation.
+ *
+ *  EtCorrelation measures the two-point correlation of
+ *  the per-event Et grid in (deltaEta, deltaPhi), averaged
+ *  in FCalEt classes. For each event the 2D FFT of the grid
+ *  is taken and its power spectrum added to the class sum,
+ *  together with the grid itself. Phi is periodic. Eta is
+ *  zero padded to at least twice its length, so there is
+ *  no wrap around in eta.
+ *
+ *  Only the sums and the number of events are written
+ *  (h2_EtCorrelation_PowerSum_FCalEt<c>,
+ *  h2_EtCorrelation_GridSum_FCalEt<c>, h1_EtCorrelation_NEvents),
+ *  so outputs of several jobs can be hadd'ed. Covariance
+ *  turns the merged sums into the covariance, see
+ *  makeEtCorrelation: the inverse FFT of the mean power
+ *  spectrum gives < sum_x E(x) E(x+d) >, and the same for
+ *  the mean grid gives sum_x <E(x)> <E(x+d)>. Their difference
+ *  divided by the number of bin pairs at that separation is
+ *  the covariance of Et of two bins a distance d apart, which
+ *  is what the window fluctuations are sums of.
+ *
+ *  The grid must have a power of two number of phi bins.
+ *
+ *  @author Yakov Kulinich
+ *  @bug No known bugs.
+ */
+
+#include "ClusterAnalysis/EtCorrelation.h"
+#include "ClusterAnalysis/EtGrid.h"
+
+#include "YKAnalysis/SharedData.h"
+
+#include <TH1D.h>
+#include <TH2D.h>
+#include <TString.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+namespace {
+  // smallest power of two >= n
+  int NextPowerOfTwo( int n )
+  {
+    int p = 1;
+    while( p < n ) p <<= 1;
+    return p;
+  }
+
+  // 2D FFT of nEtaPad x nPhi work buffer, phi contiguous.
+  // forward transform skips the zero padded eta rows.
+  void Transform2D( std::vector< std::complex< double > >& work,
+		    const ClusterAnalysis::FFT& fftEta,
+		    const ClusterAnalysis::FFT& fftPhi,
+		    int nEtaBins, bool inverse )
+  {
+    int nPhiBins = fftPhi.GetN();
+    int nRows    = inverse ? fftEta.GetN() : nEtaBins;
+    for( int row = 0; row < nRows; row++ ){
+      std::complex< double >* data = &work[ row * nPhiBins ];
+      if( inverse ) fftPhi.Inverse( data );
+      else          fftPhi.Forward( data );
+    }
+    for( int col = 0; col < nPhiBins; col++ ){
+      std::complex< double >* data = &work[ col ];
+      if( inverse ) fftEta.Inverse( data, nPhiBins );
+      else          fftEta.Forward( data, nPhiBins );
+    }
+  }
+}
+
+/** @brief Constructor for EtCorrelation.
+ *
+ *  @param1 Et grid, for binning
+ *  @param2 FCalEt class edges (TeV)
+ */
+ClusterAnalysis :: EtCorrelation :: EtCorrelation ( const EtGrid& grid,
+						    const std::vector< double >& fcalEdges )
+  : m_nEtaBins    ( grid.GetNEtaBins() ),
+    m_nPhiBins    ( grid.GetNPhiBins() ),
+    m_nEtaPad     ( NextPowerOfTwo( 2 * grid.GetNEtaBins() ) ),
+    m_fftEta      ( m_nEtaPad  ),
+    m_fftPhi      ( m_nPhiBins ),
+    m_v_fcalEdges ( fcalEdges ),
+    m_hNEvents    ( NULL ),
+    m_v_work      ( m_nEtaPad * m_nPhiBins ),
+    m_isRegistered( false )
+{
+  int nClasses = m_v_fcalEdges.size() > 1 ? m_v_fcalEdges.size() - 1 : 0;
+  if( !nClasses ) return;
+
+  m_hNEvents = new TH1D( "h1_EtCorrelation_NEvents",
+			 ";#SigmaE_{T}^{FCal} [TeV];Events",
+			 nClasses, &m_v_fcalEdges[0] );
+  m_hNEvents->SetDirectory( 0 );
+
+  for( int c = 0; c < nClasses; c++ ){
+    TString fcalTitle = Form( "%.2f < #SigmaE_{T}^{FCal} < %.2f TeV",
+			      m_v_fcalEdges[c], m_v_fcalEdges[c+1] );
+
+    // frequency indices, eta zero padded
+    TH2D* hPower = new TH2D( Form( "h2_EtCorrelation_PowerSum_FCalEt%d", c ),
+			     Form( "%s;k_{#eta};k_{#phi};#Sigma|FFT(E_{T})|^{2} [GeV^{2}]",
+				   fcalTitle.Data() ),
+			     m_nEtaPad , -0.5, m_nEtaPad  - 0.5,
+			     m_nPhiBins, -0.5, m_nPhiBins - 0.5 );
+    hPower->SetDirectory( 0 );
+    m_v_powerSum.push_back( hPower );
+
+    TH2D* hGrid = new TH2D( Form( "h2_EtCorrelation_GridSum_FCalEt%d", c ),
+			    Form( "%s;#eta;#phi;#SigmaE_{T} [GeV]", fcalTitle.Data() ),
+			    m_nEtaBins, grid.GetEtaMin(), grid.GetEtaMax(),
+			    m_nPhiBins, grid.GetPhiMin(), grid.GetPhiMax() );
+    hGrid->SetDirectory( 0 );
+    m_v_gridSum.push_back( hGrid );
+  }
+}
+
+/** @brief Destructor for EtCorrelation.
+ *
+ *  Once registered, SharedData writes them
+ *  and they are left to the output file.
+ */
+ClusterAnalysis :: EtCorrelation :: ~EtCorrelation ()
+{
+  if( m_isRegistered ) return;
+  for( auto& h : m_v_powerSum ) { delete h; }
+  for( auto& h : m_v_gridSum  ) { delete h; }
+  delete m_hNEvents;
+}
+
+/** @brief Register histograms for output
+ *
+ *  @param1 SharedData
+ *
+ *  @return void
+ */
+void ClusterAnalysis :: EtCorrelation :: Register ( YKAnalysis::SharedData* sd )
+{
+  if( !m_hNEvents ) return;
+  for( auto& h : m_v_powerSum ) { sd->AddOutputHistogram( h ); }
+  for( auto& h : m_v_gridSum  ) { sd->AddOutputHistogram( h ); }
+  sd->AddOutputHistogram( m_hNEvents );
+  m_isRegistered = true;
+}
+
+/** @brief Add an event
+ *
+ *  Events outside the FCalEt classes are skipped.
+ *  Sums are added to the histograms directly, so
+ *  autosaved outputs are consistent.
+ *
+ *  @param1 Et grid of the event
+ *  @param2 FCalEt (TeV)
+ *
+ *  @return void
+ */
+void ClusterAnalysis :: EtCorrelation :: Fill ( const EtGrid& grid, double fcalEt )
+{
+  if( !m_hNEvents ||
+      fcalEt < m_v_fcalEdges.front() || !( fcalEt < m_v_fcalEdges.back() ) ) return;
+  int c = std::upper_bound( m_v_fcalEdges.begin(), m_v_fcalEdges.end(), fcalEt )
+    - m_v_fcalEdges.begin() - 1;
+
+  std::fill( m_v_work.begin(), m_v_work.end(), std::complex< double >( 0, 0 ) );
+
+  TH2D* hGrid = m_v_gridSum[c];
+  for( int xbin = 1; xbin <= m_nEtaBins; xbin++ ){
+    const double* row = grid.GetEtaRow( xbin );
+    for( int y = 0; y < m_nPhiBins; y++ ){
+      m_v_work[ ( xbin - 1 ) * m_nPhiBins + y ] = row[y];
+      hGrid->AddBinContent( hGrid->GetBin( xbin, y + 1 ), row[y] );
+    }
+  }
+  hGrid->SetEntries( hGrid->GetEntries() + 1 );
+
+  Transform2D( m_v_work, m_fftEta, m_fftPhi, m_nEtaBins, false );
+
+  TH2D* hPower = m_v_powerSum[c];
+  for( int x = 0; x < m_nEtaPad; x++ ){
+    for( int y = 0; y < m_nPhiBins; y++ ){
+      hPower->AddBinContent( hPower->GetBin( x + 1, y + 1 ),
+			     std::norm( m_v_work[ x * m_nPhiBins + y ] ) );
+    }
+  }
+  hPower->SetEntries( hPower->GetEntries() + 1 );
+
+  m_hNEvents->Fill( fcalEt );
+}
+
+/** @brief Covariance from power spectrum and grid sums
+ *
+ *  Bins are centered on separations, deltaPhi in [-pi, pi).
+ *  Caller owns the histogram.
+ *
+ *  @param1 sum of |FFT|^2, nEtaPad x nPhi
+ *  @param2 sum of grids, nEta x nPhi
+ *  @param3 number of events in sums
+ *  @param4 name
+ *  @param5 title
+ *
+ *  @return covariance, NULL if sums do not match
+ */
+TH2D* ClusterAnalysis :: EtCorrelation :: Covariance ( const TH2D* powerSum,
+						       const TH2D* gridSum,
+						       double nEvents,
+						       const char* name,
+						       const char* title )
+{
+  int nEtaBins = gridSum ->GetNbinsX();
+  int nPhiBins = gridSum ->GetNbinsY();
+  int nEtaPad  = powerSum->GetNbinsX();
+  if( nEvents <= 0 || powerSum->GetNbinsY() != nPhiBins ||
+      nEtaPad != NextPowerOfTwo( 2 * nEtaBins ) || !FFT::IsPowerOfTwo( nPhiBins ) ){
+    std::cerr << "EtCorrelation::Covariance : " << name
+	      << " sums do not match, or no events" << std::endl;
+    return NULL;
+  }
+
+  FFT fftEta( nEtaPad  );
+  FFT fftPhi( nPhiBins );
+  std::vector< std::complex< double > > work( nEtaPad * nPhiBins );
+
+  // < sum_x E(x) E(x+d) >
+  std::vector< double > fullCorr( work.size() );
+  for( int x = 0; x < nEtaPad; x++ )
+    for( int y = 0; y < nPhiBins; y++ )
+      work[ x * nPhiBins + y ] = powerSum->GetBinContent( x + 1, y + 1 ) / nEvents;
+  Transform2D( work, fftEta, fftPhi, nEtaBins, true );
+  for( std::size_t i = 0; i < work.size(); i++ ) fullCorr[i] = work[i].real();
+
+  // sum_x <E(x)> <E(x+d)>, autocorrelation of mean grid
+  std::fill( work.begin(), work.end(), std::complex< double >( 0, 0 ) );
+  for( int x = 0; x < nEtaBins; x++ )
+    for( int y = 0; y < nPhiBins; y++ )
+      work[ x * nPhiBins + y ] = gridSum->GetBinContent( x + 1, y + 1 ) / nEvents;
+  Transform2D( work, fftEta, fftPhi, nEtaBins, false );
+  for( auto& w : work ) w = std::norm( w );
+  Transform2D( work, fftEta, fftPhi, nEtaBins, true );
+
+  double etaWidth = gridSum->GetXaxis()->GetBinWidth( 1 );
+  double phiWidth = gridSum->GetYaxis()->GetBinWidth( 1 );
+
+  TH2D* h = new TH2D( name, Form( "%s;#Delta#eta;#Delta#phi;Cov(E_{T},E_{T}) [GeV^{2}]", title ),
+		      2 * nEtaBins - 1,
+		      -( nEtaBins - 0.5 ) * etaWidth, ( nEtaBins - 0.5 ) * etaWidth,
+		      nPhiBins,
+		      -( nPhiBins / 2 + 0.5 ) * phiWidth, ( nPhiBins / 2 - 0.5 ) * phiWidth );
+  h->SetDirectory( 0 );
+
+  for( int dEta = -( nEtaBins - 1 ); dEta <= nEtaBins - 1; dEta++ ){
+    int    row    = dEta >= 0 ? dEta : nEtaPad + dEta;
+    double nPairs = double( nEtaBins - std::abs( dEta ) ) * nPhiBins;
+    for( int dPhi = -nPhiBins / 2; dPhi < nPhiBins / 2; dPhi++ ){
+      int i = row * nPhiBins + ( dPhi >= 0 ? dPhi : nPhiBins + dPhi );
+      h->SetBinContent( dEta + nEtaBins, dPhi + nPhiBins / 2 + 1,
+			( fullCorr[i] - work[i].real() ) / nPairs );
+    }
+  }
+  h->SetEntries( nEvents );
+
+  return h;
+}
@@ -0,0 +1,86 @@
+/** @file EtGrid.cxx
+ *  @brief Implementation of EtGrid.
+ *
+ *  EtGrid is a flat eta x phi grid of Et used in place
+ *  of a temporary TH2D. It is allocated once and cleared
+ *  every event. Binning is the same as TAxis::FindBin
+ *  with the same limits, so window sums do not change.
+ *  Under/overflow is not stored since the fluctuation
+ *  windows never read it.
+ *
+ *  @author Yakov Kulinich
+ *  @bug No known bugs.
+ */
+
+#include "ClusterAnalysis/EtGrid.h"
+
+#include <algorithm>
+#include <cmath>
+
+/** @brief Default Constructor for EtGrid.
+ */
+ClusterAnalysis :: EtGrid :: EtGrid ()
+  : EtGrid( 1, 0, 1, 1, 0, 1 )
+{}
+
+/** @brief Constructor for EtGrid.
+ *
+ *  @param1 number of eta bins
+ *  @param2 eta min
+ *  @param3 eta max
+ *  @param4 number of phi bins
+ *  @param5 phi min
+ *  @param6 phi max
+ */
+ClusterAnalysis :: EtGrid :: EtGrid ( int nEtaBins, double etaMin, double etaMax,
+				      int nPhiBins, double phiMin, double phiMax )
+  : m_nEtaBins( nEtaBins ), m_etaMin( etaMin ), m_etaMax( etaMax ),
+    m_nPhiBins( nPhiBins ), m_phiMin( phiMin ), m_phiMax( phiMax ),
+    m_content ( nEtaBins * nPhiBins, 0. ),
+    m_nOutside( 0 )
+{}
+
+/** @brief Destructor for EtGrid.
+ */
+ClusterAnalysis :: EtGrid :: ~EtGrid ()
+{}
+
+/** @brief Zero all bins
+ *
+ *  @return void
+ */
+void ClusterAnalysis :: EtGrid :: Clear ()
+{
+  std::fill( m_content.begin(), m_content.end(), 0. );
+}
+
+/** @brief Add weights at precomputed bins
+ *
+ *  @param1 flat indices (eta major), -1 if outside
+ *  @param2 weights
+ *  @param3 number of entries
+ *
+ *  @return void
+ */
+void ClusterAnalysis :: EtGrid :: FillBins ( const int* bin, const float* w, std::size_t n )
+{
+  double* content = m_content.data();
+  for( std::size_t i = 0; i < n; i++ ){
+    if( bin[i] < 0 ){ m_nOutside++; continue; }
+    content[ bin[i] ] += w[i];
+  }
+}
+
+/** @brief Compare with another grid of same binning
+ *
+ *  @param1 other grid
+ *
+ *  @return largest absolute bin difference
+ */
+double ClusterAnalysis :: EtGrid :: MaxAbsDiff ( const EtGrid& other ) const
+{
+  double maxDiff = 0;
+  for( std::size_t i = 0; i < m_content.size() && i < other.m_content.size(); i++ )
+    maxDiff = std::max( maxDiff, std::fabs( m_content[i] - other.m_content[i] ) );
+  return maxDiff;
+}
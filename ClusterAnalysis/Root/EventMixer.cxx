@@ -0,0 +1,134 @@
+/** @file EventMixer.cxx
+ *  @brief Implementation of EventMixer.
+ *
+ *  EventMixer keeps the Et grids of the last events of
+ *  each FCalEt class, as floats in ring buffers, to build
+ *  mixed events from. All storage is one pool allocated
+ *  at construction, nClasses x depth grids, and slots are
+ *  overwritten oldest first. Memory does not grow.
+ *
+ *  A mixed event takes each eta row of the grid from a
+ *  different stored event. Consecutive rows come from
+ *  consecutive slots, so up to depth consecutive rows (e.g.
+ *  the rows of one window, if its eta size is at most depth)
+ *  are from different events. Rows are not moved in phi,
+ *  so the phi dependence of the detector response is kept.
+ *  Single row Et is kept, correlations between rows are
+ *  removed, so window fluctuations of mixed events are the
+ *  geometry only reference for those of real events.
+ *
+ *  @author Yakov Kulinich
+ *  @bug No known bugs.
+ */
+
+#include "ClusterAnalysis/EventMixer.h"
+#include "ClusterAnalysis/EtGrid.h"
+
+#include <algorithm>
+#include <iostream>
+
+/** @brief Constructor for EventMixer.
+ *
+ *  @param1 Et grid, for binning
+ *  @param2 FCalEt class edges (TeV)
+ *  @param3 events kept per class
+ */
+ClusterAnalysis :: EventMixer :: EventMixer ( const EtGrid& grid,
+					      const std::vector< double >& fcalEdges,
+					      int depth )
+  : m_nEtaBins   ( grid.GetNEtaBins() ),
+    m_nPhiBins   ( grid.GetNPhiBins() ),
+    m_gridSize   ( m_nEtaBins * m_nPhiBins ),
+    m_depth      ( std::max( 2, depth ) ),
+    m_v_fcalEdges( fcalEdges ),
+    m_random     ( 12345 )
+{
+  int nClasses = m_v_fcalEdges.size() > 1 ? m_v_fcalEdges.size() - 1 : 0;
+  m_pool.assign( std::size_t( nClasses ) * m_depth * m_gridSize, 0.f );
+
+  m_v_next   .assign( nClasses, 0 );
+  m_v_nStored.assign( nClasses, 0 );
+  m_v_nAdded .assign( nClasses, 0 );
+  m_v_nMixed .assign( nClasses, 0 );
+}
+
+/** @brief Destructor for EventMixer.
+ */
+ClusterAnalysis :: EventMixer :: ~EventMixer ()
+{}
+
+/** @brief FCalEt class of an event
+ *
+ *  @param1 FCalEt (TeV)
+ *
+ *  @return class, -1 if outside all classes
+ */
+int ClusterAnalysis :: EventMixer :: FindClass ( double fcalEt ) const
+{
+  if( m_v_nStored.empty() ||
+      fcalEt < m_v_fcalEdges.front() || !( fcalEt < m_v_fcalEdges.back() ) ) return -1;
+  return std::upper_bound( m_v_fcalEdges.begin(), m_v_fcalEdges.end(), fcalEt )
+    - m_v_fcalEdges.begin() - 1;
+}
+
+/** @brief Store an event
+ *
+ *  Overwrites the oldest event of the class once full.
+ *
+ *  @param1 Et grid of the event
+ *  @param2 FCalEt class, from FindClass
+ *
+ *  @return void
+ */
+void ClusterAnalysis :: EventMixer :: Add ( const EtGrid& grid, int c )
+{
+  if( c < 0 ) return;
+
+  float* slot = Slot( c, m_v_next[c] );
+  for( int xbin = 1; xbin <= m_nEtaBins; xbin++ ){
+    const double* row = grid.GetEtaRow( xbin );
+    float* out = slot + ( xbin - 1 ) * m_nPhiBins;
+    for( int y = 0; y < m_nPhiBins; y++ ) out[y] = row[y];
+  }
+
+  m_v_next[c] = ( m_v_next[c] + 1 ) % m_depth;
+  if( m_v_nStored[c] < m_depth ) m_v_nStored[c]++;
+  m_v_nAdded[c]++;
+}
+
+/** @brief Build a mixed event
+ *
+ *  Class must be full (IsFull).
+ *
+ *  @param1 FCalEt class
+ *  @param2 Et grid to overwrite with the mixed event
+ *
+ *  @return void
+ */
+void ClusterAnalysis :: EventMixer :: MakeMixed ( int c, EtGrid& grid )
+{
+  int first = m_random.Integer( m_depth );
+  for( int xbin = 1; xbin <= m_nEtaBins; xbin++ ){
+    const float* in = Slot( c, ( first + xbin - 1 ) % m_depth ) + ( xbin - 1 ) * m_nPhiBins;
+    double* out = grid.GetEtaRow( xbin );
+    for( int y = 0; y < m_nPhiBins; y++ ) out[y] = in[y];
+  }
+  m_v_nMixed[c]++;
+}
+
+/** @brief Print buffer statistics
+ *
+ *  @param1 Name of caller
+ *
+ *  @return void
+ */
+void ClusterAnalysis :: EventMixer :: Print ( const std::string& caller ) const
+{
+  std::cout << caller << " : EventMixer " << GetNClasses() << " FCalEt classes x "
+	    << m_depth << " events, " << GetNBytes() / ( 1024. * 1024. ) << " MB" << std::endl;
+  for( int c = 0; c < GetNClasses(); c++ ){
+    std::cout << "   " << m_v_fcalEdges[c] << " - " << m_v_fcalEdges[c+1] << " TeV : "
+	      << m_v_nAdded[c] << " events, "
+	      << m_v_nMixed[c] << " mixed" << std::endl;
+  }
+}
@@ -0,0 +1,114 @@
+/** @file FFT.cxx
+ *  @brief Implementation of FFT.
+ *
+ *  A small iterative radix-2 complex FFT for power of two
+ *  lengths, with twiddle factors and bit reversal computed
+ *  once per length. Strided transforms (e.g. columns of a
+ *  row major 2D array) are copied to a scratch buffer.
+ *
+ *  @author Yakov Kulinich
+ *  @bug No known bugs.
+ */
+
+#include "ClusterAnalysis/FFT.h"
+
+#include <cmath>
+#include <stdexcept>
+
+/** @brief Constructor for FFT.
+ *
+ *  @param1 length, must be a power of two
+ */
+ClusterAnalysis :: FFT :: FFT ( std::size_t n )
+  : m_n( n )
+{
+  if( !IsPowerOfTwo( n ) )
+    throw std::invalid_argument( "FFT length must be a power of two" );
+
+  m_v_twiddle.resize( n / 2 );
+  for( std::size_t k = 0; k < n / 2; k++ )
+    m_v_twiddle[k] = std::polar( 1.0, -2 * M_PI * k / n );
+
+  int nBits = 0;
+  while( ( std::size_t( 1 ) << nBits ) < n ) nBits++;
+
+  m_v_reverse.resize( n );
+  for( std::size_t i = 0; i < n; i++ ){
+    std::size_t r = 0;
+    for( int b = 0; b < nBits; b++ )
+      if( i & ( std::size_t( 1 ) << b ) ) r |= std::size_t( 1 ) << ( nBits - 1 - b );
+    m_v_reverse[i] = r;
+  }
+
+  m_v_scratch.resize( n );
+}
+
+/** @brief Destructor for FFT.
+ */
+ClusterAnalysis :: FFT :: ~FFT ()
+{}
+
+/** @brief Forward transform, sum x_j exp( -2 pi i jk / n )
+ *
+ *  @param1 data
+ *  @param2 stride between values
+ *
+ *  @return void
+ */
+void ClusterAnalysis :: FFT :: Forward ( std::complex< double >* data, std::size_t stride ) const
+{
+  Transform( data, stride, false );
+}
+
+/** @brief Inverse transform, 1/n sum x_j exp( 2 pi i jk / n )
+ *
+ *  @param1 data
+ *  @param2 stride between values
+ *
+ *  @return void
+ */
+void ClusterAnalysis :: FFT :: Inverse ( std::complex< double >* data, std::size_t stride ) const
+{
+  Transform( data, stride, true );
+  for( std::size_t i = 0; i < m_n; i++ ) data[ i * stride ] /= double( m_n );
+}
+
+/** @brief Iterative radix-2 transform
+ *
+ *  @param1 data
+ *  @param2 stride between values
+ *  @param3 inverse (conjugate twiddles, no 1/n)
+ *
+ *  @return void
+ */
+void ClusterAnalysis :: FFT :: Transform ( std::complex< double >* data, std::size_t stride, bool inverse ) const
+{
+  std::complex< double >* x = stride == 1 ? data : m_v_scratch.data();
+  if( stride != 1 )
+    for( std::size_t i = 0; i < m_n; i++ ) x[i] = data[ i * stride ];
+
+  for( std::size_t i = 0; i < m_n; i++ ){
+    std::size_t r = m_v_reverse[i];
+    if( r > i ) std::swap( x[i], x[r] );
+  }
+
+  for( std::size_t len = 2; len <= m_n; len <<= 1 ){
+    std::size_t half = len / 2;
+    std::size_t step = m_n / len;
+    for( std::size_t start = 0; start < m_n; start += len ){
+      for( std::size_t k = 0; k < half; k++ ){
+	const std::complex< double >& w = m_v_twiddle[ k * step ];
+	const std::complex< double >& b = x[ start + k + half ];
+	// w * b (or conj(w) * b), written out to skip the inf/nan handling of complex *
+	double wIm = inverse ? -w.imag() : w.imag();
+	std::complex< double > t( w.real() * b.real() - wIm * b.imag(),
+				  w.real() * b.imag() + wIm * b.real() );
+	x[ start + k + half ] = x[ start + k ] - t;
+	x[ start + k        ] = x[ start + k ] + t;
+      }
+    }
+  }
+
+  if( stride != 1 )
+    for( std::size_t i = 0; i < m_n; i++ ) data[ i * stride ] = x[i];
+}
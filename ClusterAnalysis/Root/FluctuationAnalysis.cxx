@@ -11,10 +11,25 @@
  */
 
 #include "ClusterAnalysis/FluctuationAnalysis.h"
+#include "ClusterAnalysis/EtGrid.h"
+#include "ClusterAnalysis/WindowSumTable.h"
+#include "ClusterAnalysis/HistFillBuffer.h"
+#include "ClusterAnalysis/ClusterKernels.h"
+#include "ClusterAnalysis/EtCorrelation.h"
+#include "ClusterAnalysis/FFT.h"
+#include "ClusterAnalysis/EventMixer.h"
+
+#include "YKAnalysis/EventShape.h"
+#include "YKAnalysis/TDigest.h"
+#include "YKAnalysis/Kinematics.h"
 
 #include <xAODCaloEvent/CaloClusterContainer.h>
 
-#include <xAODHIEvent/HIEventShapeContainer.h>
+#include <TDirectory.h>
+#include <TTree.h>
+
+#include <algorithm>
+#include <cmath>
 
 /** @brief Default Constructor for Fluctuation Analysis.
  */
@@ -35,6 +50,38 @@ ClusterAnalysis :: FluctuationAnalysis :: FluctuationAnalysis ()
   
   m_nWindowEtBins = 250;
   m_windowEtMin   = 0;         m_windowEtMax   = 250;  // GeV
+
+  m_slidingWindows = false;
+
+  m_fillBufferSize = 100000;
+
+  m_useSIMD             = true;
+  m_validateSIMD        = false;
+  m_maxValidationDiff   = 0;
+  m_maxQnValidationDiff = 0;
+
+  m_doEtCorrelation = false;
+
+  m_doFCalEtDigest          = false;
+  m_fcalEtDigestCompression = 200;
+  m_fcalEtDigest            = NULL;
+  m_fcalEtDigestTree        = NULL;
+
+  m_doEventMixing = false;
+  m_mixingDepth   = 10;
+  m_eventMixer    = NULL;
+  m_etGridMixed   = NULL;
+
+  m_doFlowVectors     = false;
+  m_nHarmonics        = 6;
+  m_qnEtaBinsPerSlice = 10;
+  m_nQnSlices         = 0;
+
+  m_etGrid          = NULL;
+  m_etGridReference = NULL;
+  m_etCorrelation   = NULL;
+  m_windowSumTable = NULL;
+  m_h3FillBuffer   = NULL;
 }
 
 
@@ -59,6 +106,38 @@ ClusterAnalysis :: FluctuationAnalysis :: FluctuationAnalysis ( const std::strin
 
   m_nWindowEtBins = 250;
   m_windowEtMin   = 0;         m_windowEtMax   = 250;  // GeV
+
+  m_slidingWindows = false;
+
+  m_fillBufferSize = 100000;
+
+  m_useSIMD             = true;
+  m_validateSIMD        = false;
+  m_maxValidationDiff   = 0;
+  m_maxQnValidationDiff = 0;
+
+  m_doEtCorrelation = false;
+
+  m_doFCalEtDigest          = false;
+  m_fcalEtDigestCompression = 200;
+  m_fcalEtDigest            = NULL;
+  m_fcalEtDigestTree        = NULL;
+
+  m_doEventMixing = false;
+  m_mixingDepth   = 10;
+  m_eventMixer    = NULL;
+  m_etGridMixed   = NULL;
+
+  m_doFlowVectors     = false;
+  m_nHarmonics        = 6;
+  m_qnEtaBinsPerSlice = 10;
+  m_nQnSlices         = 0;
+
+  m_etGrid          = NULL;
+  m_etGridReference = NULL;
+  m_etCorrelation   = NULL;
+  m_windowSumTable = NULL;
+  m_h3FillBuffer   = NULL;
 }
 
 /** @brief Destructor for Fluctuation Analysis.
@@ -66,7 +145,16 @@ ClusterAnalysis :: FluctuationAnalysis :: FluctuationAnalysis ( const std::strin
  *  Cleans up an FluctuationAnalysis object.
  */
 ClusterAnalysis :: FluctuationAnalysis :: ~FluctuationAnalysis()
-{}
+{
+  delete m_etGrid;
+  delete m_etGridReference;
+  delete m_windowSumTable;
+  delete m_h3FillBuffer;
+  delete m_etCorrelation;
+  delete m_fcalEtDigest;
+  delete m_eventMixer;
+  delete m_etGridMixed;
+}
 
 /** @brief Setup method for Fluctuation Analysis
  *
@@ -81,10 +169,21 @@ xAOD::TReturnCode ClusterAnalysis :: FluctuationAnalysis :: Setup ()
   //-----------------
   TEnv* config = m_sd->GetConfig();
 
-  m_v_etaLimits.push_back( 0.7 );
-  m_v_etaLimits.push_back( 1.4 );
-  m_v_etaLimits.push_back( 2.1 );
-  m_v_etaLimits.push_back( 2.8 );
+  // |eta| limits, sorted so the last one is the largest.
+  // eta slices are made within the largest one.
+  for( auto& etaLimit : vectoriseD( config->GetValue( "fluctuationEtaLimits", "0.7 1.4 2.1 2.8" ) ) ){
+    if( etaLimit <= 0 || etaLimit > m_etaMax ){
+      std::cout << "Skipping EtaLimit " << etaLimit << std::endl;
+      continue;
+    }
+    m_v_etaLimits.push_back( etaLimit );
+  }
+  std::sort( m_v_etaLimits.begin(), m_v_etaLimits.end() );
+
+  if( m_v_etaLimits.empty() ){
+    std::cout << "No valid fluctuationEtaLimits" << std::endl;
+    return xAOD::TReturnCode::kFailure;
+  }
 
   for( auto& etaLimit : m_v_etaLimits ) 
     std::cout << "EtaLimit = " << etaLimit << std::endl;
@@ -92,8 +191,73 @@ xAOD::TReturnCode ClusterAnalysis :: FluctuationAnalysis :: Setup ()
   m_window_Eta_size = config->GetValue( "fluctuationWindowEtaSize", 7);
   m_window_Phi_size = config->GetValue( "fluctuationWindowPhiSize", 7);
 
+  // extra square windows, e.g. "3 5 7 9 11"
+  for( auto& size : vectoriseD( config->GetValue( "fluctuationWindowSizes", "" ) ) ){
+    if( size < 1 || size > m_nPhiBins ){
+      std::cout << "Skipping window size " << size << std::endl;
+      continue;
+    }
+    m_v_windowSizes.push_back( int( size ) );
+  }
+  m_slidingWindows = config->GetValue( "fluctuationSlidingWindows", false );
+
+  for( auto& size : m_v_windowSizes ) 
+    std::cout << "Window = " << size << "x" << size
+	      << ( m_slidingWindows ? " sliding" : " tiled" ) << std::endl;
+
   m_clusterContainerName = config->GetValue( "clusterContainerName" , "" ); 
 
+  // number of h3_EtaFCalEtWindowEt fills kept before adding to histogram
+  m_fillBufferSize = config->GetValue( "fluctuationFillBufferSize", 100000 );
+
+  // batch (SIMD) cluster Et, binning and flow vectors, or the scalar
+  // reference. validation runs both and compares grids and q-vectors.
+  m_useSIMD      = config->GetValue( "fluctuationUseSIMD", true );
+  m_validateSIMD = config->GetValue( "fluctuationValidateSIMD", false );
+  std::cout << "Cluster kernels = "
+	    << ( m_useSIMD ? YKAnalysis::Kinematics::Backend( m_useSIMD ) : "reference" )
+	    << ( m_useSIMD && m_validateSIMD ? " (validating)" : "" ) << std::endl;
+
+  // FCalEt classes (TeV)
+  m_v_fcalEtClasses = vectoriseD( config->GetValue( "fluctuationFCalEtClasses",
+						    "0.00 0.02 0.22 0.56 1.22 2.38 15.0" ) );
+
+  // deltaEta-deltaPhi Et covariance sums per FCalEt class,
+  // hadd'ed outputs give the covariance with makeEtCorrelation
+  m_doEtCorrelation = config->GetValue( "doEtCorrelation", false );
+  if( m_doEtCorrelation && !FFT::IsPowerOfTwo( m_nPhiBins ) ){
+    std::cout << "doEtCorrelation needs a power of two number of phi bins, have "
+	      << m_nPhiBins << std::endl;
+    return xAOD::TReturnCode::kFailure;
+  }
+
+  // FCalEt t-digest, written as tree fcalEtDigest. hadd'ed
+  // outputs give centrality edges with printCentralityEdges
+  m_doFCalEtDigest          = config->GetValue( "doFCalEtDigest", false );
+  m_fcalEtDigestCompression = config->GetValue( "fcalEtDigestCompression", 200. );
+
+  // mixed event window fluctuations, from the last mixingDepth
+  // events of the same FCalEt class (nClasses x depth float grids).
+  // rows of a window must all come from different events.
+  m_doEventMixing = config->GetValue( "doEventMixing", false );
+  m_mixingDepth   = std::max( 2, config->GetValue( "mixingDepth", 10 ) );
+  if( m_doEventMixing ){
+    int minDepth = m_window_Eta_size;
+    for( auto& size : m_v_windowSizes ) minDepth = std::max( minDepth, size );
+    if( m_mixingDepth < minDepth ){
+      std::cout << "mixingDepth " << m_mixingDepth << " is smaller than the largest window eta size "
+		<< minDepth << std::endl;
+      return xAOD::TReturnCode::kFailure;
+    }
+  }
+
+  // flow vectors q_n, n = 1..qnMaxHarmonic, from clusters in eta slices
+  // of qnEtaBinsPerSlice grid bins and from FCal (HIEventShape)
+  m_doFlowVectors     = config->GetValue( "doFlowVectors", false );
+  m_nHarmonics        = std::max( 1, std::min( 16, config->GetValue( "qnMaxHarmonic", 6 ) ) );
+  m_qnEtaBinsPerSlice = std::max( 1, config->GetValue( "qnEtaBinsPerSlice", 10 ) );
+  m_nQnSlices         = ( m_nEtaBins + m_qnEtaBinsPerSlice - 1 ) / m_qnEtaBinsPerSlice;
+
   return xAOD::TReturnCode::kSuccess;
 }
 
@@ -109,17 +273,7 @@ xAOD::TReturnCode ClusterAnalysis :: FluctuationAnalysis :: HistInitialize ()
 {
   std::cout << m_analysisName << " HistInitialize" << std::endl;
 
-  std::vector< double > FCalEtRanges;
-  FCalEtRanges.push_back(0.00);
-  FCalEtRanges.push_back(0.02);
-  FCalEtRanges.push_back(0.22);
-  FCalEtRanges.push_back(0.56);
-  FCalEtRanges.push_back(1.22);
-  FCalEtRanges.push_back(2.38);
-  FCalEtRanges.push_back(15.0);
-
-  TAxis* axis = 0;
-  int nFCalEtBins = FCalEtRanges.size() - 1;
+  m_etGrid = new EtGrid( m_nEtaBins, m_etaMin, m_etaMax,  m_nPhiBins, m_phiMin, m_phiMax );
 
   h3_EtaFCalEtWindowEt = new TH3D("h3_EtaFCalEtWindowEt",";#eta;#SigmaE_{T} (3.2<|#eta|<4.6) [TeV];#SigmaE_{T} Window",
 				  m_nEtaBins, m_etaMin, m_etaMax,
@@ -127,17 +281,56 @@ xAOD::TReturnCode ClusterAnalysis :: FluctuationAnalysis :: HistInitialize ()
 				  m_nWindowEtBins, m_windowEtMin, m_windowEtMax ); // for 7x7 window for now
   h3_EtaFCalEtWindowEt->Sumw2();
   m_sd->AddOutputHistogram( h3_EtaFCalEtWindowEt );
+  m_h3FillBuffer = new HistFillBuffer( h3_EtaFCalEtWindowEt, m_fillBufferSize );
+  // autosaved histograms must include buffered fills
+  m_sd->AddAutoSaveListener( this );
 
-  m_sd->AddOutputToTree< double >( "FCalEt", &m_FCalEt );
-  m_sd->AddOutputToTree< std::vector< double > >( "v_caloFluctuations", &m_v_caloFluctuations );
+  m_sd->AddOutputToTree< double >( "FCalEt", &m_FCalEt, m_outputTreeName );
+  m_sd->AddOutputToTree< std::vector< double > >( "v_caloFluctuations", &m_v_caloFluctuations, m_outputTreeName );
 
-  m_sd->AddOutputToTree< std::vector< double > >( "v_caloFluctuationEtaSlices", &m_v_caloFluctuationEtaSlices );
+  m_sd->AddOutputToTree< std::vector< double > >( "v_caloFluctuationEtaSlices", &m_v_caloFluctuationEtaSlices, m_outputTreeName );
+
+  // sized once, so branch addresses stay put
+  m_v_caloFluctuationsBySize.resize( m_v_windowSizes.size() );
+  for( unsigned int i = 0; i < m_v_windowSizes.size(); i++ ){
+    m_sd->AddOutputToTree< std::vector< double > >
+      ( Form( "v_caloFluctuations_%dx%d", m_v_windowSizes[i], m_v_windowSizes[i] ),
+	&m_v_caloFluctuationsBySize[i], m_outputTreeName );
+  }
 
   // FCalEt
   h1_FCalEt  = new TH1D("h1_FCalEt", ";#SigmaE_{T} (3.2<|#eta|<4.6) [TeV];Entries", 
 			m_nFCalEtBins * 10, m_fCalEtMin, m_fCalEtMax);
   m_sd->AddOutputHistogram( h1_FCalEt );
 
+  if( m_doEtCorrelation ){
+    m_etCorrelation = new EtCorrelation( *m_etGrid, m_v_fcalEtClasses );
+    m_etCorrelation->Register( m_sd );
+  }
+
+  if( m_doFCalEtDigest ){
+    m_fcalEtDigest = new YKAnalysis::TDigest( m_fcalEtDigestCompression );
+    // filled at HistFinalize, written with the histograms
+    TDirectory::TContext ctx( m_sd->GetOutputTree()->GetDirectory() );
+    m_fcalEtDigestTree = m_fcalEtDigest->MakeTree( "fcalEtDigest" );
+    m_sd->AddOutputObject( m_fcalEtDigestTree );
+  }
+
+  if( m_doEventMixing ){
+    m_sd->AddOutputToTree< std::vector< double > >( "v_caloFluctuationsMixed", &m_v_caloFluctuationsMixed, m_outputTreeName );
+    m_sd->AddOutputToTree< std::vector< double > >( "v_caloFluctuationEtaSlicesMixed", &m_v_caloFluctuationEtaSlicesMixed, m_outputTreeName );
+  }
+
+  if( m_doFlowVectors ){
+    // [slice * nHarmonics + n - 1], FCal slices are C, A
+    m_sd->AddOutputToTree< std::vector< float > >( "v_qnClusterX",     &m_v_qnClusterX,     m_outputTreeName );
+    m_sd->AddOutputToTree< std::vector< float > >( "v_qnClusterY",     &m_v_qnClusterY,     m_outputTreeName );
+    m_sd->AddOutputToTree< std::vector< float > >( "v_qnClusterSumEt", &m_v_qnClusterSumEt, m_outputTreeName );
+    m_sd->AddOutputToTree< std::vector< float > >( "v_qnFCalX",        &m_v_qnFCalX,        m_outputTreeName );
+    m_sd->AddOutputToTree< std::vector< float > >( "v_qnFCalY",        &m_v_qnFCalY,        m_outputTreeName );
+    m_sd->AddOutputToTree< std::vector< float > >( "v_qnFCalSumEt",    &m_v_qnFCalSumEt,    m_outputTreeName );
+  }
+
   return xAOD::TReturnCode::kSuccess;
 }
 
@@ -154,6 +347,16 @@ xAOD::TReturnCode ClusterAnalysis :: FluctuationAnalysis :: Initialize ()
 {
   std::cout << m_analysisName << " Initializing" << std::endl;
 
+  m_windowSumTable = new WindowSumTable();
+  if( m_useSIMD && m_validateSIMD )
+    m_etGridReference = new EtGrid( m_nEtaBins, m_etaMin, m_etaMax,  m_nPhiBins, m_phiMin, m_phiMax );
+
+  if( m_doEventMixing ){
+    m_etGridMixed = new EtGrid( m_nEtaBins, m_etaMin, m_etaMax,  m_nPhiBins, m_phiMin, m_phiMax );
+    m_eventMixer  = new EventMixer( *m_etGridMixed, m_v_fcalEtClasses, m_mixingDepth );
+    m_eventMixer->Print( m_analysisName );
+  }
+
   return xAOD::TReturnCode::kSuccess;
 }
 
@@ -168,22 +371,14 @@ xAOD::TReturnCode ClusterAnalysis :: FluctuationAnalysis :: ProcessEvent(){
   //-------------------------------    
   // FCALSUM                                                              
   //-------------------------------
-  m_FCalEt = -1; 
-  // calosums container, initialize here to avoid problems later
-  const xAOD::HIEventShapeContainer* caloSumContainer = 0;    // calosum container    
-
+  // HIEventShape layers 21-23, shared with other analyses
+  YKAnalysis::EventShape* eventShape = m_sd->GetEventShape();
   CHECK_STATUS( Form("%s::execute",m_analysisName.c_str() ), 
-		eventStore->retrieve( caloSumContainer, "CaloSums" ) );
+		eventShape->Retrieve( eventStore ) );
 
-  int x = 0;
-  // loop over calosums
-  for( const auto* caloSum : *caloSumContainer ){
-    if (x == 5) {
-      m_FCalEt = (  caloSum->et() * 0.001 * 0.001 ); // TeV !!!
-    }
-    x++;
-  }
+  m_FCalEt = eventShape->GetFCalEt() * 0.001 * 0.001; // TeV !!!
   h1_FCalEt->Fill( m_FCalEt );
+  if( m_fcalEtDigest ) m_fcalEtDigest->Add( m_FCalEt );
 
   //-------------------------------    
   // CALO CLUSTERS                                                                
@@ -195,28 +390,91 @@ xAOD::TReturnCode ClusterAnalysis :: FluctuationAnalysis :: ProcessEvent(){
   CHECK_STATUS( Form("%s::execute",m_analysisName.c_str() ), 
 		eventStore->retrieve( caloClusterContainer, m_clusterContainerName.c_str() ) );
       
-  // make a (temp) 2d histo which has eta,phi distribution of Et.
+  // grid which has eta,phi distribution of Et.
   // it goes to the tool
-  TH2D h2_EtaPhi("h2_EtaPhi","h2_EtaPhi",  m_nEtaBins, m_etaMin, m_etaMax,  m_nPhiBins, m_phiMin, m_phiMax);
+  m_etGrid->Clear();
+
+  std::size_t nClusters = caloClusterContainer->size();
+  if( m_useSIMD || m_doFlowVectors ){
+    // cluster kinematics into arrays, then batch Et and bins
+    m_v_clusterEta.resize( nClusters );
+    m_v_clusterPhi.resize( nClusters );
+    m_v_clusterE  .resize( nClusters );
+    m_v_clusterEt .resize( nClusters );
+    m_v_clusterBin.resize( nClusters );
+
+    std::size_t i = 0;
+    for(const auto* caloCluster : *caloClusterContainer){
+      m_v_clusterEta[i] = caloCluster->eta();
+      m_v_clusterPhi[i] = caloCluster->phi();
+      m_v_clusterE  [i] = caloCluster->e() * 0.001;   // E in GeV
+      i++;
+    }
+
+    ClusterKernels::EtBatch     ( m_v_clusterEta.data(), m_v_clusterE.data(),
+				  nClusters, m_v_clusterEt.data(), m_useSIMD );       // Et in GeV
+    ClusterKernels::GridBinBatch( *m_etGrid, m_v_clusterEta.data(), m_v_clusterPhi.data(),
+				  nClusters, m_v_clusterBin.data(), m_useSIMD );
+  }
+  if( m_useSIMD )
+    m_etGrid->FillBins( m_v_clusterBin.data(), m_v_clusterEt.data(), nClusters );
+
+  // reference, or to validate the batch path
+  if( !m_useSIMD || m_validateSIMD ){
+    EtGrid* etGrid = m_useSIMD ? m_etGridReference : m_etGrid;
+    if( m_useSIMD ) etGrid->Clear();
+
+    // loop over cluster container
+    for(const auto* caloCluster : *caloClusterContainer){
+      double cc_Eta  = caloCluster->eta();              // Phi
+      double cc_Phi  = caloCluster->phi();              // Phi
+      double cc_E    = caloCluster->e() * 0.001;        // E in GeV
+      double cc_Et   = cc_E / TMath::CosH( cc_Eta );    // Et in GeV
+
+      etGrid->Fill( cc_Eta, cc_Phi, cc_Et );  // grid to be sent to AnalyzeFluctiations
+    } // end for loop over cluster
+  }
 
-  // loop over cluster container
-  for(const auto* caloCluster : *caloClusterContainer){
-    double cc_Eta  = caloCluster->eta();              // Phi
-    double cc_Phi  = caloCluster->phi();              // Phi
-    double cc_E    = caloCluster->e() * 0.001;        // E in GeV
-    double cc_Et   = cc_E / TMath::CosH( cc_Eta );    // Et in GeV
+  if( m_useSIMD && m_validateSIMD ){
+    double diff = m_etGrid->MaxAbsDiff( *m_etGridReference );
+    if( diff > m_maxValidationDiff ) m_maxValidationDiff = diff;
+  }
+
+  if( m_etCorrelation ) m_etCorrelation->Fill( *m_etGrid, m_FCalEt );
+
+  if( m_doFlowVectors ){
+    CHECK_STATUS( Form("%s::execute",m_analysisName.c_str() ), 
+		  FillFlowVectors( nClusters ) );
+  }
 
-    h2_EtaPhi.Fill( cc_Eta, cc_Phi, cc_Et );  // temp histo to be sent to AnalyzeFluctiations
-  } // end for loop over cluster
+  // window sums from here on are O(1)
+  m_windowSumTable->Build( *m_etGrid );
   
+  // all eta limits and slices in one pass
   m_v_caloFluctuationEtaSlices.clear();
-  AnalyzeFluctuationsEtaSlices( &h2_EtaPhi, m_v_etaLimits.back(), 
-				m_v_caloFluctuationEtaSlices, h3_EtaFCalEtWindowEt );  
+  AnalyzeFluctuations( m_windowSumTable, m_window_Eta_size, m_window_Phi_size, false,
+		       m_v_caloFluctuations, &m_v_caloFluctuationEtaSlices, m_h3FillBuffer );
 
-  m_v_caloFluctuations.clear(); 
-  for( auto& etaLimit : m_v_etaLimits ){
-    m_v_caloFluctuations.
-      push_back( AnalyzeFluctuations( &h2_EtaPhi, etaLimit ) );
+  for( unsigned int i = 0; i < m_v_windowSizes.size(); i++ ){
+    int size = m_v_windowSizes[i];
+    AnalyzeFluctuations( m_windowSumTable, size, size, m_slidingWindows,
+			 m_v_caloFluctuationsBySize[i], NULL, NULL );
+  }
+
+  // mixed event from earlier events of this FCalEt class,
+  // then this event goes into the buffer
+  if( m_eventMixer ){
+    m_v_caloFluctuationsMixed.clear();
+    m_v_caloFluctuationEtaSlicesMixed.clear();
+
+    int fcalClass = m_eventMixer->FindClass( m_FCalEt );
+    if( m_eventMixer->IsFull( fcalClass ) ){
+      m_eventMixer->MakeMixed( fcalClass, *m_etGridMixed );
+      m_windowSumTable->Build( *m_etGridMixed );
+      AnalyzeFluctuations( m_windowSumTable, m_window_Eta_size, m_window_Phi_size, false,
+			   m_v_caloFluctuationsMixed, &m_v_caloFluctuationEtaSlicesMixed, NULL );
+    }
+    m_eventMixer->Add( *m_etGrid, fcalClass );
   }
   
   return xAOD::TReturnCode::kSuccess;
@@ -232,6 +490,21 @@ xAOD::TReturnCode ClusterAnalysis :: FluctuationAnalysis :: Finalize()
 {
   std::cout << m_analysisName << " Finalizing" << std::endl;
 
+  if( m_etGrid )
+    std::cout << m_analysisName << " : " << m_etGrid->GetNOutside()
+	      << " clusters outside eta-phi grid" << std::endl;
+  if( m_h3FillBuffer ) m_h3FillBuffer->Print( m_analysisName );
+  if( m_etGridReference )
+    std::cout << m_analysisName << " : " << YKAnalysis::Kinematics::Backend( m_useSIMD )
+	      << " vs reference cluster Et grid, max bin difference "
+	      << m_maxValidationDiff << " GeV" << std::endl;
+  if( m_etGridReference && m_doFlowVectors )
+    std::cout << m_analysisName << " : " << YKAnalysis::Kinematics::Backend( m_useSIMD )
+	      << " vs reference cluster q-vectors, max difference "
+	      << m_maxQnValidationDiff << " GeV" << std::endl;
+  if( m_fcalEtDigest ) m_fcalEtDigest->Print( m_analysisName + " FCalEt" );
+  if( m_eventMixer ) m_eventMixer->Print( m_analysisName );
+
   return xAOD::TReturnCode::kSuccess;
 }
 
@@ -245,167 +518,233 @@ xAOD::TReturnCode ClusterAnalysis :: FluctuationAnalysis :: HistFinalize()
 {
   std::cout << m_analysisName << " HistFinalize" << std::endl;
 
+  // remaining buffered fills
+  if( m_h3FillBuffer ) m_h3FillBuffer->Flush();
+
+  if( m_fcalEtDigest ) m_fcalEtDigest->WriteToTree( m_fcalEtDigestTree );
+
   return xAOD::TReturnCode::kSuccess;
 }
 
+/** @brief Method called before histograms are autosaved
+ *
+ *  Flushes buffered fills, so the autosaved
+ *  h3 agrees with the tree and other histograms.
+ *
+ *  @return void
+ */
+void ClusterAnalysis :: FluctuationAnalysis :: OnAutoSave()
+{
+  if( m_h3FillBuffer ) m_h3FillBuffer->Flush();
+}
+
 /*
-  @brief Method to analize fluctuations in Calorimeters
+  @brief Method to compute flow vectors of the event
 
-  Loops though the events calo distribution using a window of 
-  some size and looks at caloFluctuation of all windows.
+  Q_n = ( sum Et cos(n phi), sum Et sin(n phi) ), not normalized,
+  with sum Et alongside, all in GeV. For clusters, in eta slices
+  of the grid, using the cluster arrays of this event. For FCal,
+  from the Et moments of HIEventShape layers 21-23, per side
+  (n > 7 are left 0). Event shape must be retrieved already.
   
-  @param1 TH2D Et distribution by (eta,phi)
-  and TH1F to fill with window Et
-  @param2 etaLimit (Absolute value)
+  @param1 number of clusters in arrays
 
-  @return caloFluctuation of Et in that event
+  @return xAOD::TReturnCode
 */
-double ClusterAnalysis :: FluctuationAnalysis :: AnalyzeFluctuations ( TH2D* h2_EtaPhi, double etaLimit ){
-  int nXbins =  h2_EtaPhi->GetXaxis()->GetNbins();
-  int nYbins =  h2_EtaPhi->GetYaxis()->GetNbins();
+xAOD::TReturnCode ClusterAnalysis :: FluctuationAnalysis :: FillFlowVectors ( std::size_t nClusters ){
+  // clusters
+  m_v_clusterSlice.resize( nClusters );
+  m_v_qnSumX .assign( m_nQnSlices * m_nHarmonics, 0. );
+  m_v_qnSumY .assign( m_nQnSlices * m_nHarmonics, 0. );
+  m_v_qnSumEt.assign( m_nQnSlices, 0. );
+
+  int nPhiBins = m_etGrid->GetNPhiBins();
+  for( std::size_t i = 0; i < nClusters; i++ ){
+    int bin = m_v_clusterBin[i];
+    int slice = bin < 0 ? -1 : ( bin / nPhiBins ) / m_qnEtaBinsPerSlice;
+    m_v_clusterSlice[i] = slice;
+    if( slice >= 0 ) m_v_qnSumEt[ slice ] += m_v_clusterEt[i];
+  }
+
+  ClusterKernels::QVectorBatch( m_v_clusterPhi.data(), m_v_clusterEt.data(), m_v_clusterSlice.data(),
+				nClusters, m_nHarmonics, m_v_qnSumX.data(), m_v_qnSumY.data(), m_useSIMD );
+
+  if( m_useSIMD && m_validateSIMD ){
+    m_v_qnRefX.assign( m_v_qnSumX.size(), 0. );
+    m_v_qnRefY.assign( m_v_qnSumY.size(), 0. );
+    ClusterKernels::QVectorBatch( m_v_clusterPhi.data(), m_v_clusterEt.data(), m_v_clusterSlice.data(),
+				  nClusters, m_nHarmonics, m_v_qnRefX.data(), m_v_qnRefY.data(), false );
+    for( std::size_t i = 0; i < m_v_qnSumX.size(); i++ ){
+      double diff = std::max( std::fabs( m_v_qnSumX[i] - m_v_qnRefX[i] ),
+			      std::fabs( m_v_qnSumY[i] - m_v_qnRefY[i] ) );
+      if( diff > m_maxQnValidationDiff ) m_maxQnValidationDiff = diff;
+    }
+  }
+
+  m_v_qnClusterX    .assign( m_v_qnSumX .begin(), m_v_qnSumX .end() );
+  m_v_qnClusterY    .assign( m_v_qnSumY .begin(), m_v_qnSumY .end() );
+  m_v_qnClusterSumEt.assign( m_v_qnSumEt.begin(), m_v_qnSumEt.end() );
+
+  // FCal, from the event shape sums
+  const YKAnalysis::EventShape* eventShape = m_sd->GetEventShape();
+
+  m_v_qnFCalX    .assign( 2 * m_nHarmonics, 0. );
+  m_v_qnFCalY    .assign( 2 * m_nHarmonics, 0. );
+  m_v_qnFCalSumEt.assign( 2, 0. );
+  int nFCalHarmonics = std::min( m_nHarmonics, int( YKAnalysis::EventShape::kNHarmonics ) );
+  for( int side = YKAnalysis::EventShape::kC; side <= YKAnalysis::EventShape::kA; side++ ){
+    m_v_qnFCalSumEt[ side ] = eventShape->GetFCalEt( side ) * 0.001;
+    for( int n = 1; n <= nFCalHarmonics; n++ ){
+      m_v_qnFCalX[ side * m_nHarmonics + n - 1 ] = eventShape->GetFCalEtCos( side, n ) * 0.001;
+      m_v_qnFCalY[ side * m_nHarmonics + n - 1 ] = eventShape->GetFCalEtSin( side, n ) * 0.001;
+    }
+  }
+
+  return xAOD::TReturnCode::kSuccess;
+}
 
-  int xcorner, xBinMax;
+/*
+  @brief Method to get eta bin range within etaLimit
+
+  @param1 etaLimit (Absolute value)
+  @param2 first eta bin (output)
+  @param3 last eta bin (output)
 
-  if( etaLimit != h2_EtaPhi->GetXaxis()->GetXmax() ){
-    xcorner = h2_EtaPhi->GetXaxis()->FindBin( -etaLimit + DELTA );
-    xBinMax = h2_EtaPhi->GetXaxis()->FindBin(  etaLimit + DELTA ) - 1;
+  @return void
+*/
+void ClusterAnalysis :: FluctuationAnalysis :: GetEtaBinRange ( double etaLimit, int& xBinMin, int& xBinMax ){
+  if( etaLimit != m_etGrid->GetEtaMax() ){
+    xBinMin = m_etGrid->FindEtaBin( -etaLimit + DELTA );
+    xBinMax = m_etGrid->FindEtaBin(  etaLimit + DELTA ) - 1;
   }
   else{
-    xcorner = 1;
-    xBinMax = nXbins;
+    xBinMin = 1;
+    xBinMax = m_etGrid->GetNEtaBins();
   }
+}
 
-  double sumWindowEt   = 0;
-  double sumWindowSqEt = 0;
-  int    nWindows      = 0;
-   
-  // nested loop moves top left corner of window around grid
-  // if part of the other edge of h2 doesnt fit
-  // it is not taken into account
-  for(  ; xcorner <= xBinMax - m_window_Eta_size + 1; xcorner += m_window_Eta_size ){
-    for(int ycorner = 1; ycorner <= nYbins - m_window_Phi_size + 1; ycorner += m_window_Phi_size ){
-
-      double windowEt   = 0;
-      // scans that window
-      for( int xbin = xcorner; xbin < xcorner + m_window_Eta_size; xbin++){
- 	for( int ybin = ycorner; ybin < ycorner + m_window_Phi_size; ybin++){
-	  windowEt += h2_EtaPhi->GetBinContent( xbin, ybin );
-	}
-      }
-      
-      // total
-      sumWindowEt += windowEt;
-      sumWindowSqEt += (windowEt * windowEt);
-      nWindows++;
-    }  // end ycorner loop
-  } // end xcorner loop
-
-  double caloFluctuation =
-    TMath::Sqrt( sumWindowSqEt / nWindows
-		 - TMath::Power( sumWindowEt / nWindows , 2) );
+/*
+  @brief Method to get statistics of one row of windows
+
+  Windows in a row share the same eta corner and move in phi.
   
-  if( m_sd->DoPrint() ){
-    std::cerr << "   etaSize       = " << m_window_Eta_size << std::endl;
-    std::cerr << "   phiSize       = " << m_window_Phi_size << std::endl;
-    std::cerr << "   sumWindowEt   = " << sumWindowEt << std::endl;
-    std::cerr << "   sumWindowSqEt = " << sumWindowSqEt << std::endl;
-    std::cerr << "   nWindows      = " << nWindows << std::endl;
-    std::cerr << "   caloFluc      = " << caloFluctuation << std::endl;
-    std::cerr << "   FCalEt        = " << m_FCalEt << std::endl;
+  @param1 WindowSumTable of Et distribution by (eta,phi)
+  @param2 eta corner (bin)
+  @param3 window eta size (bins)
+  @param4 window phi size (bins)
+  @param5 sliding (true) or tiled (false) windows
+  @param6 fill buffer of TH3D with window Et, NULL if none
+  @param7 statistics of the row (output)
+
+  @return void
+*/
+void ClusterAnalysis :: FluctuationAnalysis :: AnalyzeWindowRow
+( const WindowSumTable* sumTable, int xcorner, int etaSize, int phiSize, bool sliding,
+  HistFillBuffer* h3FillBuffer, WindowStats& rowStats ){
+  int nYbins =  sumTable->GetNPhiBins();
+
+  int yStep    = sliding ? 1      : phiSize;
+  int yLastBin = sliding ? nYbins : nYbins - phiSize + 1;
+
+  // eta and FCalEt bins are the same for the whole row
+  double etaValue = 0;
+  int    etaBin = 0, fcalBin = 0;
+  if( h3FillBuffer ){
+    etaValue = h3_EtaFCalEtWindowEt->GetXaxis()->GetBinCenter( xcorner );
+    etaBin   = h3FillBuffer->FindBinX( etaValue );
+    fcalBin  = h3FillBuffer->FindBinY( m_FCalEt );
   }
 
-  return caloFluctuation;
+  rowStats.Clear();
+  for(int ycorner = 1; ycorner <= yLastBin; ycorner += yStep ){
+    double windowEt = sumTable->GetWindowSum( xcorner, ycorner, etaSize, phiSize );
+    rowStats.Add( windowEt );
+
+    // fill 3d histo
+    if( h3FillBuffer )
+      h3FillBuffer->Fill( etaBin, fcalBin, etaValue, m_FCalEt, windowEt );
+  }
 }
 
 /*
   @brief Method to analize fluctuations in Calorimeters
 
-  Loops though the events calo distribution using a window of 
-  some size and looks at caloFluctuation of all windows.
-  
-  Also do this for individual eta slices.
+  Looks at caloFluctuation (standard deviation of window Et)
+  of all windows within each eta limit, and optionally of
+  each eta slice (row of windows) within the largest limit.
 
-  @param1 TH2D Et distribution by (eta,phi)
-  and TH1F to fill with window Et
-  @param2 etaLimit (Absolute value)
-  @param3 vector with caloFluctuations of eta slices.
+  Each row of windows is scanned once, no matter how many
+  limits use it. The statistics of a limit are merged from
+  the statistics of its rows.
 
-  @return caloFluctuation of Et in that event
+  Tiled windows do not overlap and do not wrap in phi.
+  Sliding windows start at every bin, and wrap around in phi.
+  
+  @param1 WindowSumTable of Et distribution by (eta,phi)
+  @param2 window eta size (bins)
+  @param3 window phi size (bins)
+  @param4 sliding (true) or tiled (false) windows
+  @param5 vector with caloFluctuations, one per eta limit (output)
+  @param6 vector with caloFluctuations of eta slices, NULL if not needed (output)
+  @param7 fill buffer of TH3D with window Et of eta slices, NULL if none
+
+  @return void
 */
-double ClusterAnalysis :: FluctuationAnalysis :: AnalyzeFluctuationsEtaSlices
-( TH2D* h2_EtaPhi, double etaLimit, std::vector<double>& v_caloFluctuationEtaSlices, TH3D* h3_EtaFCalEtWindowEt ){
-  int nXbins =  h2_EtaPhi->GetXaxis()->GetNbins();
-  int nYbins =  h2_EtaPhi->GetYaxis()->GetNbins();
+void ClusterAnalysis :: FluctuationAnalysis :: AnalyzeFluctuations
+( const WindowSumTable* sumTable, int etaSize, int phiSize, bool sliding,
+  std::vector<double>& v_caloFluctuations,
+  std::vector<double>* v_caloFluctuationEtaSlices,
+  HistFillBuffer* h3FillBuffer ){
 
-  int xcorner, xBinMax;
+  int xStep  = sliding ? 1 : etaSize;
+  int nLimit = m_v_etaLimits.size();
 
-  if( etaLimit != h2_EtaPhi->GetXaxis()->GetXmax() ){
-    xcorner = h2_EtaPhi->GetXaxis()->FindBin( -etaLimit + DELTA );
-    xBinMax = h2_EtaPhi->GetXaxis()->FindBin(  etaLimit + DELTA ) - 1;
-  }
-  else{
-    xcorner = 1;
-    xBinMax = nXbins;
-  }
+  // rows are computed once per call
+  m_v_rowStats.resize( sumTable->GetNEtaBins() + 1 );
+  m_v_rowDone.assign ( sumTable->GetNEtaBins() + 1, false );
 
-  double sumWindowEt   = 0;
-  double sumWindowSqEt = 0;
-  int    nWindows      = 0;
-   
-  // nested loop moves top left corner of window around grid
-  // if part of the other edge of h2 doesnt fit
-  // it is not taken into account
-  for(  ; xcorner <= xBinMax - m_window_Eta_size + 1; xcorner += m_window_Eta_size ){
+  v_caloFluctuations.assign( nLimit, 0 );
 
-    double sumWindowEtSlice   = 0;
-    double sumWindowSqEtSlice = 0;
-    int    nWindowsSlice      = 0;
+  // largest limit first, it fills the slices and the histogram
+  for( int iLimit = nLimit - 1; iLimit >= 0; iLimit-- ){
+    bool isSliceLimit = ( iLimit == nLimit - 1 );
 
-    for(int ycorner = 1; ycorner <= nYbins - m_window_Phi_size + 1; ycorner += m_window_Phi_size ){
-      
-      double windowEt   = 0;
-      // scans that window
-      for( int xbin = xcorner; xbin < xcorner + m_window_Eta_size; xbin++){
- 	for( int ybin = ycorner; ybin < ycorner + m_window_Phi_size; ybin++){
-	  windowEt += h2_EtaPhi->GetBinContent( xbin, ybin );
-	}
+    int xcorner, xBinMax;
+    GetEtaBinRange( m_v_etaLimits[ iLimit ], xcorner, xBinMax );
+
+    WindowStats limitStats;
+    
+    // nested loop moves top left corner of window around grid
+    // if part of the other edge of h2 doesnt fit
+    // it is not taken into account
+    for(  ; xcorner <= xBinMax - etaSize + 1; xcorner += xStep ){
+      if( !m_v_rowDone[ xcorner ] ){
+	AnalyzeWindowRow( sumTable, xcorner, etaSize, phiSize, sliding,
+			  isSliceLimit ? h3FillBuffer : NULL,
+			  m_v_rowStats[ xcorner ] );
+	m_v_rowDone[ xcorner ] = true;
       }
-      
-      // total
-      sumWindowEt += windowEt;
-      sumWindowSqEt += (windowEt * windowEt);
-      nWindows++;
-      
-      // fill 3d histo
-      double etaValue = h3_EtaFCalEtWindowEt->GetXaxis()->GetBinCenter( xcorner );
-      h3_EtaFCalEtWindowEt->Fill( etaValue, m_FCalEt, windowEt );
+      const WindowStats& rowStats = m_v_rowStats[ xcorner ];
+
+      limitStats.Merge( rowStats );
 
       // eta (xcorner) slices
-      sumWindowEtSlice += windowEt;
-      sumWindowSqEtSlice += (windowEt * windowEt);
-      nWindowsSlice++;
-    }  // end ycorner loop
-    
-    double caloFluctuationSlice = 
-      TMath::Sqrt( sumWindowSqEtSlice / nWindowsSlice
-		   - TMath::Power( sumWindowEtSlice / nWindowsSlice , 2) );
-    
-    v_caloFluctuationEtaSlices.push_back( caloFluctuationSlice );
-  } // end xcorner loop
+      if( isSliceLimit && v_caloFluctuationEtaSlices )
+	v_caloFluctuationEtaSlices->push_back( rowStats.GetStdDev() );
+    } // end xcorner loop
 
-  double caloFluctuation =
-    TMath::Sqrt( sumWindowSqEt / nWindows
-		 - TMath::Power( sumWindowEt / nWindows , 2) );
+    double caloFluctuation = limitStats.GetStdDev();
+    v_caloFluctuations[ iLimit ] = caloFluctuation;
   
-  if( m_sd->DoPrint() ){
-    std::cerr << "   etaSize       = " << m_window_Eta_size << std::endl;
-    std::cerr << "   phiSize       = " << m_window_Phi_size << std::endl;
-    std::cerr << "   sumWindowEt   = " << sumWindowEt << std::endl;
-    std::cerr << "   sumWindowSqEt = " << sumWindowSqEt << std::endl;
-    std::cerr << "   nWindows      = " << nWindows << std::endl;
-    std::cerr << "   caloFluc      = " << caloFluctuation << std::endl;
-    std::cerr << "   FCalEt        = " << m_FCalEt << std::endl;
-  }
-
-  return caloFluctuation;
+    if( m_sd->DoPrint() ){
+      std::cerr << "   etaLimit      = " << m_v_etaLimits[ iLimit ] << std::endl;
+      std::cerr << "   etaSize       = " << etaSize << std::endl;
+      std::cerr << "   phiSize       = " << phiSize << std::endl;
+      std::cerr << "   sliding       = " << sliding << std::endl;
+      std::cerr << "   meanWindowEt  = " << limitStats.GetMean() << std::endl;
+      std::cerr << "   nWindows      = " << limitStats.GetN() << std::endl;
+      std::cerr << "   caloFluc      = " << caloFluctuation << std::endl;
+      std::cerr << "   FCalEt        = " << m_FCalEt << std::endl;
+    }
+  } // end limit loop
 }
@@ -0,0 +1,35 @@
+/** @file WindowStats.cxx
+ *  @brief Implementation of WindowStats.
+ *
+ *  WindowStats keeps the count, mean and sum of squared
+ *  deviations of window Et. Windows are added one at a
+ *  time with Welford's update, and statistics of disjoint
+ *  sets of windows (e.g. eta rows) are combined with
+ *  Chan's merge. Unlike sum and sum of squares this does
+ *  not lose precision when the mean is large compared
+ *  to the spread.
+ *
+ *  @author Yakov Kulinich
+ *  @bug No known bugs.
+ */
+
+#include "ClusterAnalysis/WindowStats.h"
+
+/** @brief Merge statistics of another set of windows
+ *
+ *  @param1 other statistics
+ *
+ *  @return void
+ */
+void ClusterAnalysis :: WindowStats :: Merge ( const WindowStats& other )
+{
+  if( other.m_n == 0 ) return;
+  if( m_n == 0 ){ *this = other; return; }
+
+  long   n     = m_n + other.m_n;
+  double delta = other.m_mean - m_mean;
+
+  m_mean += delta * other.m_n / n;
+  m_m2   += other.m_m2 + delta * delta * m_n * other.m_n / n;
+  m_n     = n;
+}
@@ -0,0 +1,57 @@
+/** @file WindowSumTable.cxx
+ *  @brief Implementation of WindowSumTable.
+ *
+ *  WindowSumTable is a summed-area table of an EtGrid.
+ *  It is built once per event, after which the Et sum of
+ *  any eta x phi window is four lookups (six if the window
+ *  wraps around in phi), independent of the window size.
+ *  This makes sliding windows and several window sizes
+ *  per event cheap.
+ *
+ *  @author Yakov Kulinich
+ *  @bug No known bugs.
+ */
+
+#include "ClusterAnalysis/WindowSumTable.h"
+#include "ClusterAnalysis/EtGrid.h"
+
+/** @brief Default Constructor for WindowSumTable.
+ */
+ClusterAnalysis :: WindowSumTable :: WindowSumTable ()
+  : m_nEtaBins( 0 ),
+    m_nPhiBins( 0 )
+{}
+
+/** @brief Destructor for WindowSumTable.
+ */
+ClusterAnalysis :: WindowSumTable :: ~WindowSumTable ()
+{}
+
+/** @brief Build table from grid
+ *
+ *  Storage is kept if the grid size does not change.
+ *
+ *  @param1 Et grid
+ *
+ *  @return void
+ */
+void ClusterAnalysis :: WindowSumTable :: Build ( const EtGrid& grid )
+{
+  m_nEtaBins = grid.GetNEtaBins();
+  m_nPhiBins = grid.GetNPhiBins();
+
+  int stride = m_nPhiBins + 1;
+  m_sum.assign( ( m_nEtaBins + 1 ) * stride, 0. );
+
+  for( int xbin = 1; xbin <= m_nEtaBins; xbin++ ){
+    const double* row  = grid.GetEtaRow( xbin );
+    const double* prev = &m_sum[ ( xbin - 1 ) * stride ];
+    double*       cur  = &m_sum[   xbin       * stride ];
+
+    double rowSum = 0;
+    for( int ybin = 1; ybin <= m_nPhiBins; ybin++ ){
+      rowSum    += row[ ybin - 1 ];
+      cur[ ybin ] = prev[ ybin ] + rowSum;
+    }
+  }
+}
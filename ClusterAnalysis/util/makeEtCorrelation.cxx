@@ -0,0 +1,112 @@
+/** @file makeEtCorrelation.cxx
+ *  @brief Make Et covariance histograms from EtCorrelation sums
+ *
+ *  Reads the EtCorrelation sums (see EtCorrelation) of one
+ *  or more output files, e.g. hadd'ed outputs of all jobs,
+ *  adds them and writes the deltaEta-deltaPhi Et covariance
+ *  of each FCalEt class as h2_EtCorrelation_FCalEt<c>.
+ *
+ *  Usage: makeEtCorrelation file.root [file2.root ...]
+ *                           [-o EtCorrelation.root]
+ *
+ *  @author Yakov Kulinich
+ *  @bug No known bugs.
+ */
+
+#include "ClusterAnalysis/EtCorrelation.h"
+
+#include <TFile.h>
+#include <TH1D.h>
+#include <TH2D.h>
+#include <TString.h>
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+  // add h from file to sum, cloning the first one
+  template< typename T >
+  bool AddTo( std::unique_ptr< T >& sum, TFile* f, const char* name )
+  {
+    T* h = dynamic_cast< T* >( f->Get( name ) );
+    if( !h ) return false;
+    if( !sum ){
+      sum.reset( static_cast< T* >( h->Clone() ) );
+      sum->SetDirectory( 0 );
+    } else if( !sum->Add( h ) ) return false;
+    return true;
+  }
+}
+
+int main( int argc, char* argv[] ){
+
+  std::string outName = "EtCorrelation.root";
+  
+  std::vector< std::string > v_inNames;
+  for( int i = 1; i < argc; i++ ){
+    std::string arg = argv[i];
+    if( arg == "-o" && i + 1 < argc ){ outName = argv[++i]; continue; }
+    v_inNames.push_back( arg );
+  }
+  
+  if( v_inNames.empty() ){
+    std::cerr << "Usage: makeEtCorrelation file.root [file2.root ...] [-o EtCorrelation.root]" << std::endl;
+    return 1;
+  }
+
+  std::unique_ptr< TH1D > hNEvents;
+  std::vector< std::unique_ptr< TH2D > > v_powerSum, v_gridSum;
+
+  for( auto& inName : v_inNames ){
+    std::unique_ptr< TFile > fin( TFile::Open( inName.c_str() ) );
+    if( !fin || fin->IsZombie() ){
+      std::cerr << "makeEtCorrelation : cannot open " << inName << std::endl;
+      return 1;
+    }
+    if( !AddTo( hNEvents, fin.get(), "h1_EtCorrelation_NEvents" ) ){
+      std::cerr << "makeEtCorrelation : no matching h1_EtCorrelation_NEvents in "
+		<< inName << std::endl;
+      return 1;
+    }
+    int nClasses = hNEvents->GetNbinsX();
+    v_powerSum.resize( nClasses );
+    v_gridSum .resize( nClasses );
+    for( int c = 0; c < nClasses; c++ ){
+      if( !AddTo( v_powerSum[c], fin.get(), Form( "h2_EtCorrelation_PowerSum_FCalEt%d", c ) ) ||
+	  !AddTo( v_gridSum [c], fin.get(), Form( "h2_EtCorrelation_GridSum_FCalEt%d" , c ) ) ){
+	std::cerr << "makeEtCorrelation : missing or mismatched sums for class "
+		  << c << " in " << inName << std::endl;
+	return 1;
+      }
+    }
+  }
+
+  TFile fout( outName.c_str(), "RECREATE" );
+  if( fout.IsZombie() ){
+    std::cerr << "makeEtCorrelation : cannot create " << outName << std::endl;
+    return 1;
+  }
+
+  for( int c = 0; c < hNEvents->GetNbinsX(); c++ ){
+    double fcalLow  = hNEvents->GetXaxis()->GetBinLowEdge( c + 1 );
+    double fcalHigh = hNEvents->GetXaxis()->GetBinUpEdge ( c + 1 );
+    double nEvents  = hNEvents->GetBinContent( c + 1 );
+    std::cout << " " << fcalLow << " < FCalEt < " << fcalHigh
+	      << " TeV : " << nEvents << " events" << std::endl;
+    if( nEvents <= 0 ) continue;
+
+    TString name  = Form( "h2_EtCorrelation_FCalEt%d", c );
+    TString title = Form( "%.2f < #SigmaE_{T}^{FCal} < %.2f TeV", fcalLow, fcalHigh );
+    TH2D* h = ClusterAnalysis::EtCorrelation::Covariance
+      ( v_powerSum[c].get(), v_gridSum[c].get(), nEvents, name, title );
+    if( !h ) return 1;
+    h->SetDirectory( &fout );
+  }
+  
+  fout.Write();
+  std::cout << "Wrote " << outName << std::endl;
+  
+  return 0;
+}
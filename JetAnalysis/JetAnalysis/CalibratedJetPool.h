@@ -0,0 +1,55 @@
+/** @file CalibratedJetPool.h
+ *  @brief Function prototypes for CalibratedJetPool.
+ *
+ *  This contains the prototypes and members
+ *  for CalibratedJetPool
+ *
+ *  @author Yakov Kulinich
+ *  @bug No known bugs.
+ */
+
+#ifndef JETANALYSIS_CALIBRATEDJETPOOL_H
+#define JETANALYSIS_CALIBRATEDJETPOOL_H
+
+#include <xAODJet/JetContainer.h>
+
+#include <string>
+#include <vector>
+
+namespace JetAnalysis{
+
+  class CalibratedJetPool{
+  public:
+    CalibratedJetPool();
+    ~CalibratedJetPool();
+
+    // We do not want any copies of this class
+    CalibratedJetPool           ( const CalibratedJetPool& ) = delete ;
+    CalibratedJetPool& operator=( const CalibratedJetPool& ) = delete ;
+
+    void       Reset   ();
+    xAOD::Jet* Acquire ( const xAOD::Jet& );
+    void       Keep    ();
+
+    const xAOD::JetContainer* GetContainer() const { return m_container; }
+
+    unsigned long GetNAllocated () const { return m_nAllocated; }
+    unsigned long GetNAcquired  () const { return m_nAcquired;  }
+    std::size_t   GetPoolSize   () const { return m_v_pool.size(); }
+
+    void Print ( const std::string& ) const;
+
+  private:
+    // jets with their own private store, reused every event
+    std::vector< xAOD::Jet* > m_v_pool;
+    std::size_t               m_nUsed;
+
+    // view of the jets kept this event, does not own them
+    xAOD::JetContainer*       m_container;
+
+    unsigned long m_nAllocated;
+    unsigned long m_nAcquired;
+  };
+}
+
+#endif
@@ -5,6 +5,7 @@
 #include <vector>
 #include <map>
 #include <cmath>
+#include <stdint.h>
 
 #include <TGraph.h>
 #include <TAxis.h>
@@ -15,8 +16,20 @@ class HIJESUncertaintyProvider
 {
 public:
   typedef std::map<std::string,std::vector<TGraph*> > map_t;
+
+  // Table for one component in one eta bin. The graph points are
+  // stored as (x, y, slope) and a uniform grid of pT cells gives
+  // the segment to start from, so a lookup is TGraph::Eval
+  // (linear, extrapolated with the edge segments) without a search.
+  struct TableInfo
+  {
+    float xMin, xMax, invStep;
+    int   offset, nPoints;
+    int   cellOffset, nCells;
+  };
+
   HIJESUncertaintyProvider(){}
-  HIJESUncertaintyProvider(std::string fname);
+  HIJESUncertaintyProvider(std::string fname, float tolerance=1e-5, bool useCache=true);
   ~HIJESUncertaintyProvider();
 
 
@@ -26,6 +39,20 @@ public:
   void GetUncertaintyComponentKeys(std::vector<std::string>& vec) const;
   float GetTotalUncertainty(float pt, float eta) const;
 
+  // resolve component name once, then use the handle
+  int GetComponentHandle(const std::string& comp) const;
+  inline float GetUncertaintyComponent(int handle, float pt, float eta) const;
+  void GetUncertaintyComponent(int handle, const float* pt, const float* eta, 
+			       size_t n, float* out) const;
+
+  float GetTableTolerance() const { return m_table_tolerance; }
+  float GetTableDeviation() const { return m_table_deviation; }
+
+  // binary cache of tables and JES histograms, next to the ROOT file
+  bool WriteCache(const std::string& cache_path, const std::string& fname) const;
+  bool UsingCache() const { return m_map_addr!=NULL; }
+  static std::string DataPath(const std::string& fname);
+
 
   static std::string s_uncert_graph_prefix;
 
@@ -64,11 +91,100 @@ private:
     return (m_use_abs_eta ?  std::abs(eta) :  eta);
   }
 
+  void ReadROOT(const std::string& fname);
+  void BuildTables();
 
-
+  // cache file layout: header, then sections at the given offsets
+  struct CacheHeader
+  {
+    char     magic[8];
+    uint32_t version;
+    uint32_t nComponents;
+    uint32_t nEtaBins;
+    uint32_t nJESHistos;
+    float    deviation;
+    uint32_t padding;
+    int64_t  sourceSize[2];
+    int64_t  sourceMtime[2];
+    uint64_t namesOffset;
+    uint64_t etaOffset;
+    uint64_t infoOffset;
+    uint64_t tablesOffset;
+    uint64_t cellsOffset;
+    uint64_t jesOffset;
+    uint64_t fileSize;
+  };
+
+  static const char s_cache_magic[8];
+  static const uint32_t s_cache_version;
+  static const unsigned int s_cache_name_length=64;
+  static const char* s_jes_file;
+
+  bool ReadCache(const std::string& cache_path, const std::string& fname);
+  static bool GetSourceInfo(const std::string& fname, int64_t& size, int64_t& mtime);
+  static uint64_t Align(uint64_t offset) { return (offset+7) & ~uint64_t(7); }
+
+  inline unsigned int LookupEtaBinFast(float eta) const;
+  inline float EvalTable(const TableInfo& t, float x) const;
+
+  // component names in handle order
+  std::vector<std::string> m_component_names;
+  int m_baseline_handle;
+
+  // eta bin edges, as in m_eta_axis
+  std::vector<double> m_eta_edges;
+  int m_n_eta_bins;
+
+  // [ handle * m_n_eta_bins + eta bin ]
+  std::vector<TableInfo> m_table_info_store;
+  std::vector<float> m_table_store;
+  std::vector<int> m_cell_store;
+  const TableInfo* m_table_info;
+  const float* m_tables;
+  const int* m_cells;
+
+  float m_table_tolerance;
+  float m_table_deviation;
+
+  // mapped cache file, the table pointers point into it
+  void* m_map_addr;
+  size_t m_map_size;
 
 
 };
 
+inline unsigned int HIJESUncertaintyProvider::LookupEtaBinFast(float eta) const
+{
+  // as TAxis::FindBin, under/overflow go to the first/last bin
+  float x=GetSign(eta);
+  unsigned int eta_bin=0;
+  for(int i=1; i<m_n_eta_bins; i++) eta_bin+=(x >= m_eta_edges[i]);
+  return eta_bin;
+}
+
+inline float HIJESUncertaintyProvider::EvalTable(const TableInfo& t, float x) const
+{
+  if(t.nPoints < 2) return (t.nPoints ? m_tables[t.offset+1] : 0);
+  const float* p=m_tables + t.offset;
+  int seg;
+  if(x <= t.xMin) seg=0;
+  else if(x >= t.xMax) seg=t.nPoints-2;
+  else
+  {
+    int cell=int((x - t.xMin)*t.invStep);
+    if(cell > t.nCells-1) cell=t.nCells-1;
+    seg=m_cells[t.cellOffset + cell];
+    while(x >= p[3*(seg+1)]) seg++;
+    while(seg > 0 && x < p[3*seg]) seg--;
+  }
+  p+=3*seg;
+  return p[1] + p[2]*(x - p[0]);
+}
+
+inline float HIJESUncertaintyProvider::GetUncertaintyComponent(int handle, float pt, float eta) const
+{
+  return EvalTable(m_table_info[handle*m_n_eta_bins + LookupEtaBinFast(eta)], pt*m_GeV);
+}
+
 
 #endif
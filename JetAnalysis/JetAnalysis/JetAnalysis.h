@@ -17,6 +17,7 @@
 #include <TLorentzVector.h>
 
 class TH2;
+class TBranch;
 class JetContainer;
 
 class JetCleaningTool;
@@ -28,8 +29,18 @@ namespace InDet{
   class InDetTrackSelectionTool;
 }
 
+namespace YKAnalysis{
+  class EtaPhiGrid;
+}
+
 namespace JetAnalysis{
   
+  class CalibratedJetPool;
+  class SystematicFanOut;
+  class JetMatcher;
+  class ResponseHistograms;
+  class PreCalibrationFilter;
+
   class JetAnalysis : public YKAnalysis::Analysis{
   public:
     JetAnalysis();
@@ -45,8 +56,14 @@ namespace JetAnalysis{
     virtual xAOD::TReturnCode Finalize       ();
     virtual xAOD::TReturnCode HistFinalize   ();
 
+    xAOD::TReturnCode InitializeUncertaintyTools();
+
     void UncertaintyProviderJES( const xAOD::Jet*,
-				 std::vector<float>& );
+				 float*, int = 1 );
+
+    void ReserveSysUncert ( std::size_t );
+    void QuantizeSysUncert();
+    void FillResponse     ();
 
     Float_t DeltaR( const xAOD::Jet* ,   
 		    const xAOD::Jet* );
@@ -75,11 +92,67 @@ namespace JetAnalysis{
 
     std::vector< bool > v_isCleanJet; 
 
+    // truth -> reco (MC), trigger -> offline (data)
+    std::vector< int   > vT_matchIndex;
+    std::vector< float > vT_matchDR;
+    std::vector< float > vT_matchPtRatio;
+    std::vector< int   > vTrig_matchIndex;
+    std::vector< float > vTrig_matchDR;
+    std::vector< float > vTrig_matchPtRatio;
+
+    // calibrated jets, reused every event
+    CalibratedJetPool* m_calibJetPool;
+
+    // skips calibrating jets that cannot pass the pT cut, NULL if off
+    PreCalibrationFilter* m_preCalibFilter;
+
+    // track - jet association
+    unsigned char            m_trackQuality;
+    YKAnalysis::EtaPhiGrid*  m_trackGrid;
+    std::vector< float >     m_v_trkEta;
+    std::vector< float >     m_v_trkPhi;
+    std::vector< float >     m_v_trkPt;
+    std::vector< float >     m_v_trkConeR;
+    std::vector< float >     m_v_trkPtThresholds;
+    std::vector< double >    m_v_trkPtSums;
+
     std::vector< std::vector< float > > v_sysUncert;
     int m_nSysUncert;
     int m_nSysUncert_pp;
     int m_nSysUncert_HI;
 
+    // flat layout: [ component * m_sysCapacity + jet ],
+    // one branch per component, optionally int16
+    bool                     m_sysUncertFlat;
+    float                    m_sysUncertPrecision;
+    int                      m_nSysJets;
+    std::size_t              m_sysCapacity;
+    std::vector< float >     m_v_sysUncertFlat;
+    std::vector< Short_t >   m_v_sysUncertQ;
+    std::vector< TBranch* >  m_v_sysBranches;
+    unsigned long            m_nSysSaturated;
+
+    // jet matching, NULL if off
+    JetMatcher*              m_jetMatcher;
+    // truth -> reco per fan out variation, for response only
+    JetMatcher*              m_sysJetMatcher;
+    std::vector< int   >     m_v_sysMatchIndex;
+    std::vector< float >     m_v_sysMatchDR;
+    std::vector< float >     m_v_sysMatchPtRatio;
+
+    // response matrices filled online (MC), NULL if off
+    ResponseHistograms*      m_responseHists;
+    bool                     m_doResponseHists;
+
+    // all JES variations applied to each jet in one pass
+    SystematicFanOut*        m_sysFanOut;
+    bool                     m_doSysFanOut;
+    float                    m_sysFanOutPtFactor;
+
+    // HI JES components, resolved once
+    int m_hiFlavCompositionHandle;
+    int m_hiFlavResponseHandle;
+
     // configs
     bool        m_isData        ;
     bool        m_doSystematics ;
@@ -0,0 +1,79 @@
+/** @file JetMatcher.h
+ *  @brief Function prototypes for JetMatcher.
+ *
+ *  This contains the prototypes and members
+ *  for JetMatcher
+ *
+ *  @author Yakov Kulinich
+ *  @bug No known bugs.
+ */
+
+#ifndef JETANALYSIS_JETMATCHER_H
+#define JETANALYSIS_JETMATCHER_H
+
+#include <TLorentzVector.h>
+#include <Rtypes.h>
+
+#include <string>
+#include <vector>
+
+namespace YKAnalysis{
+  class EtaPhiGrid;
+}
+
+namespace JetAnalysis{
+
+  class JetMatcher{
+  public:
+    enum Strategy { kGreedy, kOptimal };
+
+    JetMatcher( float, Strategy = kGreedy );
+    ~JetMatcher();
+
+    // We do not want any copies of this class
+    JetMatcher           ( const JetMatcher& ) = delete ;
+    JetMatcher& operator=( const JetMatcher& ) = delete ;
+
+    static bool GetStrategy ( const std::string&, Strategy& );
+
+    void Match ( const std::vector< TLorentzVector >&,  // from
+		 const std::vector< TLorentzVector >&,  // to
+		 std::vector< int   >&,                 // index in to, -1 if none
+		 std::vector< float >&,                 // deltaR
+		 std::vector< float >&,                 // pT to / pT from
+		 const UChar_t* = NULL );               // to jets used, all if NULL
+
+    float         GetMaxDR    () const { return m_maxDR;    }
+    Strategy      GetStrategy () const { return m_strategy; }
+
+    unsigned long GetNMatched () const { return m_nMatched; }
+    unsigned long GetNFrom    () const { return m_nFrom;    }
+
+  private:
+    // candidate pair within maximum deltaR
+    struct Pair { float dR; int from; int to; };
+
+    void MatchGreedy  ( int, int );
+    void MatchOptimal ( int, int );
+
+    float    m_maxDR;
+    Strategy m_strategy;
+
+    YKAnalysis::EtaPhiGrid* m_grid;
+
+    // scratch, kept between events
+    std::vector< float > m_v_fromEta, m_v_fromPhi;
+    std::vector< float > m_v_toEta  , m_v_toPhi, m_v_toPt;
+    std::vector< int   > m_v_near;
+    std::vector< Pair  > m_v_pairs;
+    std::vector< int   > m_v_assignment;
+    std::vector< double > m_v_cost, m_v_u, m_v_v, m_v_minv;
+    std::vector< int    > m_v_p, m_v_way;
+    std::vector< char   > m_v_used;
+
+    unsigned long m_nMatched;
+    unsigned long m_nFrom;
+  };
+}
+
+#endif
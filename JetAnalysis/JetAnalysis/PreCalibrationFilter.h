@@ -0,0 +1,59 @@
+/** @file PreCalibrationFilter.h
+ *  @brief Function prototypes for PreCalibrationFilter.
+ *
+ *  This contains the prototypes and members
+ *  for PreCalibrationFilter
+ *
+ *  @author Yakov Kulinich
+ *  @bug No known bugs.
+ */
+
+#ifndef JETANALYSIS_PRECALIBRATIONFILTER_H
+#define JETANALYSIS_PRECALIBRATIONFILTER_H
+
+#include <string>
+#include <vector>
+
+namespace JetAnalysis{
+
+  class PreCalibrationFilter{
+  public:
+    PreCalibrationFilter( int, float, bool, int );
+    ~PreCalibrationFilter();
+
+    void StartEvent  ();
+    bool CanSkip     ( float, float, float ) const;
+    bool Sample      ();
+    void Skip        ();
+    void Check       ( float, float, float, float, bool );
+
+    bool IsVerifying () const { return m_verify; }
+    bool IsWarmingUp () const { return m_nEvents <= m_nWarmupEvents; }
+
+    void Print ( const std::string& ) const;
+
+  private:
+    int EtaBin ( float ) const;
+
+    int   m_nWarmupEvents;
+    float m_margin;
+    bool  m_verify;
+    // calibrate every Nth jet that could be skipped
+    int   m_sampleEvery;
+
+    // largest calibrated / EM scale pT seen, per |eta| bin
+    float                m_etaBinWidth;
+    std::vector< float > m_v_maxResponse;
+
+    long          m_nEvents;
+    unsigned long m_nJets;
+    unsigned long m_nSkipped;
+    unsigned long m_nCanSkip;
+    unsigned long m_nChecked;
+    unsigned long m_nViolations;
+
+    static const unsigned long s_maxViolationPrints;
+  };
+}
+
+#endif
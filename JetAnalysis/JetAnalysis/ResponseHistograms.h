@@ -0,0 +1,61 @@
+/** @file ResponseHistograms.h
+ *  @brief Function prototypes for ResponseHistograms.
+ *
+ *  This contains the prototypes and members
+ *  for ResponseHistograms
+ *
+ *  @author Yakov Kulinich
+ *  @bug No known bugs.
+ */
+
+#ifndef JETANALYSIS_RESPONSEHISTOGRAMS_H
+#define JETANALYSIS_RESPONSEHISTOGRAMS_H
+
+#include <THnSparse.h>
+
+#include <string>
+#include <vector>
+
+class TEnv;
+
+namespace YKAnalysis{
+  class SharedData;
+}
+
+namespace JetAnalysis{
+
+  class ResponseHistograms{
+  public:
+    ResponseHistograms( int, TEnv* );
+    ~ResponseHistograms();
+
+    // We do not want any copies of this class
+    ResponseHistograms           ( const ResponseHistograms& ) = delete ;
+    ResponseHistograms& operator=( const ResponseHistograms& ) = delete ;
+
+    void Register ( YKAnalysis::SharedData* );
+
+    // variation 0 is nominal, 1 + v is fan out variation v
+    void Fill ( int, float, float, float, float );
+
+    int  GetNVariations () const { return m_v_response.size(); }
+
+  private:
+    THnSparseF* MakeHist ( const std::string&, const std::vector< double >&, 
+			   const std::string& ) const;
+
+    std::vector< double > m_v_ptBins;
+    std::vector< double > m_v_ratioBins;
+    std::vector< double > m_v_etaBins;
+    std::vector< double > m_v_fcalBins;
+
+    // truth pT, reco pT, |eta|, FCalEt
+    std::vector< THnSparseF* > m_v_response;
+    // truth pT, reco / truth pT, |eta|, FCalEt
+    std::vector< THnSparseF* > m_v_ptResponse;
+
+    bool m_isRegistered;
+  };
+}
+
+#endif
@@ -0,0 +1,84 @@
+/** @file SystematicFanOut.h
+ *  @brief Function prototypes for SystematicFanOut.
+ *
+ *  This contains the prototypes and members
+ *  for SystematicFanOut
+ *
+ *  @author Yakov Kulinich
+ *  @bug No known bugs.
+ */
+
+#ifndef JETANALYSIS_SYSTEMATICFANOUT_H
+#define JETANALYSIS_SYSTEMATICFANOUT_H
+
+#include <Rtypes.h>
+
+#include <string>
+#include <vector>
+
+class TBranch;
+
+namespace YKAnalysis{
+  class SharedData;
+}
+
+namespace JetAnalysis{
+
+  class SystematicFanOut{
+  public:
+    SystematicFanOut( int, float );
+    ~SystematicFanOut();
+
+    // We do not want any copies of this class
+    SystematicFanOut           ( const SystematicFanOut& ) = delete ;
+    SystematicFanOut& operator=( const SystematicFanOut& ) = delete ;
+
+    void   AddBranches ( YKAnalysis::SharedData*, const std::string& );
+
+    void   Reset       ( std::size_t );
+    float* NextJet     ( float );
+    bool   CanPass     () const;
+    void   Drop        ();
+    void   CopyLastJet ( float*, std::size_t ) const;
+    void   Compute     ();
+
+    std::size_t GetStride      () const { return m_capacity; }
+    int         GetNJets       () const { return m_nJets; }
+    int         GetNVariations () const { return 2 * m_nComponents; }
+
+    const UChar_t* GetPassNominal () const { return m_v_passNominal.data(); }
+
+    // variation 2*i is component i up, 2*i+1 down
+    const float*  GetPt   ( int v ) const { return &m_v_ptVar  [ v * m_capacity ]; }
+    const UChar_t* GetPass ( int v ) const { return &m_v_passVar[ v * m_capacity ]; }
+
+    void Print ( const std::string& ) const;
+
+  private:
+    void Reserve    ( std::size_t );
+    void SetAddress ();
+
+    int         m_nComponents;
+    float       m_ptMin;
+
+    int         m_nJets;
+    std::size_t m_capacity;
+
+    // [ component * m_capacity + jet ]
+    std::vector< float >   m_v_uncert;
+    // [ jet ], masks are bytes written as /O leaves
+    std::vector< float >   m_v_pt;
+    std::vector< UChar_t > m_v_passNominal;
+    // [ variation * m_capacity + jet ]
+    std::vector< float >   m_v_ptVar;
+    std::vector< UChar_t > m_v_passVar;
+
+    std::vector< TBranch* > m_v_branches;
+
+    unsigned long m_nCandidates;
+    unsigned long m_nKept;
+    unsigned long m_nPassNominal;
+  };
+}
+
+#endif
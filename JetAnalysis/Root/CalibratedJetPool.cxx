@@ -0,0 +1,104 @@
+/** @file CalibratedJetPool.cxx
+ *  @brief Implementation of CalibratedJetPool.
+ *
+ *  CalibratedJetPool holds the calibrated copies of
+ *  the reco jets. Instead of a new xAOD::Jet with a new
+ *  private store for every jet of every event, the pool
+ *  keeps its jets and their private stores across events
+ *  and copies each input jet's aux data over one of them.
+ *  Once the pool has grown to the largest jet multiplicity
+ *  seen, the calibration path does not allocate jets.
+ *
+ *  Usage per event:
+ *    Reset();
+ *    for each jet :
+ *      xAOD::Jet* j = Acquire( *jet ); calibrate j;
+ *      if( keep j ) Keep();
+ *    GetContainer() has the kept jets.
+ *
+ *  @author Yakov Kulinich
+ *  @bug No known bugs.
+ */
+
+#include "JetAnalysis/CalibratedJetPool.h"
+
+#include <iostream>
+
+/** @brief Default Constructor for CalibratedJetPool.
+ */
+JetAnalysis :: CalibratedJetPool :: CalibratedJetPool ()
+  : m_nUsed     ( 0 ),
+    m_container ( new xAOD::JetContainer( SG::VIEW_ELEMENTS ) ),
+    m_nAllocated( 0 ),
+    m_nAcquired ( 0 )
+{}
+
+/** @brief Destructor for CalibratedJetPool.
+ */
+JetAnalysis :: CalibratedJetPool :: ~CalibratedJetPool ()
+{
+  delete m_container;
+  for( auto& jet : m_v_pool ) { delete jet; }
+}
+
+/** @brief Start of event
+ *
+ *  Empties the view, jets stay in the pool.
+ *
+ *  @return void
+ */
+void JetAnalysis :: CalibratedJetPool :: Reset ()
+{
+  m_container->clear();
+  m_nUsed = 0;
+}
+
+/** @brief Get a pooled copy of a jet
+ *
+ *  The copy is only kept if Keep() is called,
+ *  otherwise it is reused by the next Acquire.
+ *
+ *  @param1 Jet to copy
+ *
+ *  @return pointer to pooled copy
+ */
+xAOD::Jet* JetAnalysis :: CalibratedJetPool :: Acquire ( const xAOD::Jet& jet )
+{
+  if( m_nUsed == m_v_pool.size() ){
+    xAOD::Jet* newJet = new xAOD::Jet();
+    newJet->makePrivateStore();
+    m_v_pool.push_back( newJet );
+    m_nAllocated++;
+  }
+  m_nAcquired++;
+
+  xAOD::Jet* pooledJet = m_v_pool[ m_nUsed ];
+  *pooledJet = jet;   // copies aux data into the existing private store
+  return pooledJet;
+}
+
+/** @brief Keep last acquired jet
+ *
+ *  Adds it to the view container.
+ *
+ *  @return void
+ */
+void JetAnalysis :: CalibratedJetPool :: Keep ()
+{
+  m_container->push_back( m_v_pool[ m_nUsed ] );
+  m_nUsed++;
+}
+
+/** @brief Print allocation statistics
+ *
+ *  @param1 Name of caller
+ *
+ *  @return void
+ */
+void JetAnalysis :: CalibratedJetPool :: Print ( const std::string& caller ) const
+{
+  std::cout << caller << " : CalibratedJetPool "
+	    << m_nAcquired  << " jets calibrated, "
+	    << m_nAllocated << " jets allocated, "
+	    << m_v_pool.size() << " in pool" << std::endl;
+}
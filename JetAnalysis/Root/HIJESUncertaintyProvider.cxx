@@ -3,33 +3,80 @@
 #include <iostream>
 #include <iomanip>
 #include <sstream>
+#include <fstream>
 #include <TFile.h>
 #include <TH1D.h>
 #include <TList.h>
 #include <set>
 #include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 std::string HIJESUncertaintyProvider::s_uncert_graph_prefix="g_uncert_";
 
-HIJESUncertaintyProvider::HIJESUncertaintyProvider(std::string fname) : m_GeV(1),
-									m_eta_axis(0),
-									m_use_abs_eta(true),
-									m_use_JES_tool(false)
+const char HIJESUncertaintyProvider::s_cache_magic[8]={'Y','K','H','I','J','E','S','\0'};
+const uint32_t HIJESUncertaintyProvider::s_cache_version=1;
+const char* HIJESUncertaintyProvider::s_jes_file="cc_sys_090816.root";
+
+HIJESUncertaintyProvider::HIJESUncertaintyProvider(std::string fname, float tolerance, bool useCache) : m_GeV(1),
+														    m_eta_axis(0),
+														    m_use_abs_eta(true),
+														    m_use_JES_tool(false),
+														    m_baseline_handle(-1),
+														    m_n_eta_bins(0),
+														    m_table_info(NULL),
+														    m_tables(NULL),
+														    m_cells(NULL),
+														    m_table_tolerance(tolerance),
+														    m_table_deviation(0),
+														    m_map_addr(NULL),
+														    m_map_size(0)
 {
-  
-  TString xfn = gSystem->GetFromPipe("echo $ROOTCOREBIN");
-  TFile* fin=TFile::Open(xfn + "/../JetAnalysis/data/" + fname.c_str());
-  if(!fin)
+  std::cout << std::setw(40) << "HIJESUncertaintyProvider : Initialization of HI JES uncertainty provider" << std::endl;
+
+  std::string cache_name=fname.substr(0,fname.rfind(".root"))+".bin";
+  if(useCache && ReadCache(DataPath(cache_name),fname))
   {
-    std::cerr << "Instantiating HIJESUncertaintyProvider. Input file does not exist: " << fin << std::endl;
+    std::cout << std::setw(40) << "HIJESUncertaintyProvider : Using cache " << DataPath(cache_name) << std::endl;
+    return;
+  }
+
+  ReadROOT(fname);
+  BuildTables();
+}
+
+HIJESUncertaintyProvider::~HIJESUncertaintyProvider()
+{
+  for(map_t::iterator mItr=m_uncertainty_graphs.begin(); mItr!=m_uncertainty_graphs.end(); mItr++)
+    for(unsigned int i=0; i<mItr->second.size(); i++) delete mItr->second[i];
+  for(unsigned int i=0; i<m_vJEShistos.size(); i++) delete m_vJEShistos[i];
+  delete m_eta_axis;
+  if(m_map_addr) munmap(m_map_addr,m_map_size);
+}
+
+std::string HIJESUncertaintyProvider::DataPath(const std::string& fname)
+{
+  const char* rootcorebin=gSystem->Getenv("ROOTCOREBIN");
+  return std::string(rootcorebin ? rootcorebin : ".") + "/../JetAnalysis/data/" + fname;
+}
+
+void HIJESUncertaintyProvider::ReadROOT(const std::string& fname)
+{
+  TFile* fin=TFile::Open(DataPath(fname).c_str());
+  if(!fin || fin->IsZombie())
+  {
+    std::cerr << "Instantiating HIJESUncertaintyProvider. Input file does not exist: " << DataPath(fname) << std::endl;
     throw;
   }
-  else {
-  	std::cout << std::setw(40) << "HIJESUncertaintyProvider : Initialization of HI JES uncertainty provider" << std::endl;
-  	std::cout << std::setw(40) << "HIJESUncertaintyProvider : Using file " << xfn << "/../JetAnalysis/data/" << fname.c_str() << std::endl;
-  }	
+  std::cout << std::setw(40) << "HIJESUncertaintyProvider : Using file " << DataPath(fname) << std::endl;
   	
-  m_eta_axis=(TAxis*)fin->Get("eta_axis");
+  m_eta_axis=(TAxis*)fin->Get("eta_axis")->Clone();
 
   TList* f_keys=fin->GetListOfKeys();
   std::set<std::string> component_keys;
@@ -61,19 +108,184 @@ HIJESUncertaintyProvider::HIJESUncertaintyProvider(std::string fname) : m_GeV(1)
     }
   }
   fin->Close();
+  delete fin;
 
   // load histograms for JES
   //HI JES <-> crosscalibration
-  TFile* f_HI_JES = new TFile(xfn + "/../JetAnalysis/data/cc_sys_090816.root","read");
+  TFile* f_HI_JES=TFile::Open(DataPath(s_jes_file).c_str(),"read");
+  if(!f_HI_JES || f_HI_JES->IsZombie())
+  {
+    std::cerr << "Instantiating HIJESUncertaintyProvider. Input file does not exist: " << DataPath(s_jes_file) << std::endl;
+    throw;
+  }
   for(int ybin=0;ybin<7;ybin++) 
-    { m_vJEShistos.push_back( (TH1D*)f_HI_JES->Get(Form("fsys_rel_%i",ybin))); }
+  {
+    TH1D* h=(TH1D*)f_HI_JES->Get(Form("fsys_rel_%i",ybin));
+    // keep them after the file is closed
+    if(h) h->SetDirectory(0);
+    m_vJEShistos.push_back(h);
+  }
   f_HI_JES->Close();
+  delete f_HI_JES;
 }
 
-HIJESUncertaintyProvider::~HIJESUncertaintyProvider()
+bool HIJESUncertaintyProvider::GetSourceInfo(const std::string& fname, int64_t& size, int64_t& mtime)
 {
-  //for(std::vector<TH1D*>::iterator itr=m_uncertainty_graphs.begin(); itr!=m_uncertainty_graphs.end(); itr++) delete (*itr);
-  //delete m_eta_axis;
+  Long_t id, flags, modtime;
+  Long64_t fsize;
+  if(gSystem->GetPathInfo(DataPath(fname).c_str(),&id,&fsize,&flags,&modtime)) return false;
+  size=fsize;
+  mtime=modtime;
+  return true;
+}
+
+bool HIJESUncertaintyProvider::ReadCache(const std::string& cache_path, const std::string& fname)
+{
+  int fd=open(cache_path.c_str(),O_RDONLY);
+  if(fd < 0) return false;
+  struct stat st;
+  if(fstat(fd,&st) || st.st_size < (off_t)sizeof(CacheHeader))
+  {
+    close(fd);
+    return false;
+  }
+  // pages are shared between processes reading the same file
+  void* addr=mmap(NULL,st.st_size,PROT_READ,MAP_SHARED,fd,0);
+  close(fd);
+  if(addr==MAP_FAILED) return false;
+
+  const char* base=(const char*)addr;
+  const CacheHeader& h=*(const CacheHeader*)base;
+  bool ok=(!memcmp(h.magic,s_cache_magic,sizeof(h.magic)) && h.version==s_cache_version &&
+	   h.fileSize==(uint64_t)st.st_size);
+
+  // stale if the ROOT inputs changed since it was written
+  int64_t size[2], mtime[2];
+  ok=ok && GetSourceInfo(fname,size[0],mtime[0]) && GetSourceInfo(s_jes_file,size[1],mtime[1]);
+  for(int i=0; ok && i<2; i++) ok=(size[i]==h.sourceSize[i] && mtime[i]==h.sourceMtime[i]);
+  if(!ok)
+  {
+    std::cout << std::setw(40) << "HIJESUncertaintyProvider : Cache " << cache_path << " is out of date, reading ROOT files" << std::endl;
+    munmap(addr,st.st_size);
+    return false;
+  }
+  // same check as BuildTables, which runs on the ROOT path
+  if(!(h.deviation <= m_table_tolerance))
+  {
+    std::cout << std::setw(40) << "HIJESUncertaintyProvider : Cache " << cache_path << " table deviation " << h.deviation
+	      << " above tolerance " << m_table_tolerance << ", reading ROOT files" << std::endl;
+    munmap(addr,st.st_size);
+    return false;
+  }
+
+  m_map_addr=addr;
+  m_map_size=st.st_size;
+
+  const char* names=base+h.namesOffset;
+  m_component_names.clear();
+  for(uint32_t i=0; i<h.nComponents; i++)
+    m_component_names.push_back(std::string(names+i*s_cache_name_length));
+  m_baseline_handle=GetComponentHandle("baseline");
+
+  m_n_eta_bins=h.nEtaBins;
+  const double* eta_edges=(const double*)(base+h.etaOffset);
+  m_eta_edges.assign(eta_edges,eta_edges+m_n_eta_bins+1);
+
+  m_table_info=(const TableInfo*)(base+h.infoOffset);
+  m_tables=(const float*)(base+h.tablesOffset);
+  m_cells=(const int*)(base+h.cellsOffset);
+  m_table_deviation=h.deviation;
+
+  // small, so rebuilt as histograms
+  const double* jes=(const double*)(base+h.jesOffset);
+  for(uint32_t ih=0; ih<h.nJESHistos; ih++)
+  {
+    int nbins=(int)*jes++;
+    if(nbins < 0)
+    {
+      m_vJEShistos.push_back(NULL);
+      continue;
+    }
+    TH1D* hist=new TH1D(Form("fsys_rel_%i",ih),"",nbins,jes);
+    hist->SetDirectory(0);
+    jes+=nbins+1;
+    for(int b=0; b<=nbins+1; b++) hist->SetBinContent(b,jes[b]);
+    jes+=nbins+2;
+    for(int b=0; b<=nbins+1; b++) hist->SetBinError(b,jes[b]);
+    jes+=nbins+2;
+    m_vJEShistos.push_back(hist);
+  }
+  return true;
+}
+
+bool HIJESUncertaintyProvider::WriteCache(const std::string& cache_path, const std::string& fname) const
+{
+  CacheHeader h;
+  memset(&h,0,sizeof(h));
+  memcpy(h.magic,s_cache_magic,sizeof(h.magic));
+  h.version=s_cache_version;
+  h.nComponents=m_component_names.size();
+  h.nEtaBins=m_n_eta_bins;
+  h.nJESHistos=m_vJEShistos.size();
+  h.deviation=m_table_deviation;
+  if(!GetSourceInfo(fname,h.sourceSize[0],h.sourceMtime[0]) ||
+     !GetSourceInfo(s_jes_file,h.sourceSize[1],h.sourceMtime[1])) return false;
+
+  std::vector<char> names(h.nComponents*s_cache_name_length,'\0');
+  for(uint32_t i=0; i<h.nComponents; i++)
+  {
+    if(m_component_names[i].size() >= s_cache_name_length) return false;
+    memcpy(&names[i*s_cache_name_length],m_component_names[i].data(),m_component_names[i].size());
+  }
+
+  std::vector<double> jes;
+  for(uint32_t ih=0; ih<h.nJESHistos; ih++)
+  {
+    const TH1* hist=m_vJEShistos[ih];
+    if(!hist)
+    {
+      jes.push_back(-1);
+      continue;
+    }
+    int nbins=hist->GetNbinsX();
+    jes.push_back(nbins);
+    for(int b=1; b<=nbins+1; b++) jes.push_back(hist->GetXaxis()->GetBinLowEdge(b));
+    for(int b=0; b<=nbins+1; b++) jes.push_back(hist->GetBinContent(b));
+    for(int b=0; b<=nbins+1; b++) jes.push_back(hist->GetBinError(b));
+  }
+
+  unsigned int nTables=h.nComponents*h.nEtaBins;
+  const TableInfo* info_end=m_table_info+nTables-1;
+  uint64_t nFloats=(nTables ? info_end->offset+3*info_end->nPoints : 0);
+  uint64_t nCells=(nTables ? info_end->cellOffset+info_end->nCells : 0);
+
+  // every section starts on an 8 byte boundary
+  uint64_t offset=sizeof(CacheHeader);
+  h.namesOffset=offset;  offset=Align(offset+names.size());
+  h.etaOffset=offset;    offset=Align(offset+m_eta_edges.size()*sizeof(double));
+  h.infoOffset=offset;   offset=Align(offset+nTables*sizeof(TableInfo));
+  h.tablesOffset=offset; offset=Align(offset+nFloats*sizeof(float));
+  h.cellsOffset=offset;  offset=Align(offset+nCells*sizeof(int));
+  h.jesOffset=offset;    offset=Align(offset+jes.size()*sizeof(double));
+  h.fileSize=offset;
+
+  std::ofstream out(cache_path.c_str(),std::ios::binary | std::ios::trunc);
+  if(!out) return false;
+  std::vector<char> pad(8,'\0');
+  out.write((const char*)&h,sizeof(h));
+  out.write(names.data(),names.size());
+  out.write(pad.data(),h.etaOffset-h.namesOffset-names.size());
+  out.write((const char*)m_eta_edges.data(),m_eta_edges.size()*sizeof(double));
+  out.write(pad.data(),h.infoOffset-h.etaOffset-m_eta_edges.size()*sizeof(double));
+  out.write((const char*)m_table_info,nTables*sizeof(TableInfo));
+  out.write(pad.data(),h.tablesOffset-h.infoOffset-nTables*sizeof(TableInfo));
+  out.write((const char*)m_tables,nFloats*sizeof(float));
+  out.write(pad.data(),h.cellsOffset-h.tablesOffset-nFloats*sizeof(float));
+  out.write((const char*)m_cells,nCells*sizeof(int));
+  out.write(pad.data(),h.jesOffset-h.cellsOffset-nCells*sizeof(int));
+  out.write((const char*)jes.data(),jes.size()*sizeof(double));
+  out.write(pad.data(),h.fileSize-h.jesOffset-jes.size()*sizeof(double));
+  return out.good();
 }
 
 int HIJESUncertaintyProvider:: GetEtaUJERBin( float eta ){
@@ -92,32 +304,43 @@ int HIJESUncertaintyProvider:: GetEtaUJERBin( float eta ){
 
 float HIJESUncertaintyProvider::GetUncertaintyComponent(std::string comp, float pt, float eta) const
 {
-
-  map_t::const_iterator mItr=m_uncertainty_graphs.find(comp);
-  if(mItr==m_uncertainty_graphs.end())
+  int handle=GetComponentHandle(comp);
+  if(handle < 0)
   {
     std::cerr << "No component with name " << comp << std::endl;
     throw;
   }
-  
-  int eta_bin=LookupEtaBin(eta);
-  return mItr->second.at(eta_bin)->Eval(pt*m_GeV);
+  return GetUncertaintyComponent(handle,pt,eta);
+}
+
+int HIJESUncertaintyProvider::GetComponentHandle(const std::string& comp) const
+{
+  std::vector<std::string>::const_iterator nItr=std::find(m_component_names.begin(),m_component_names.end(),comp);
+  if(nItr==m_component_names.end()) return -1;
+  return nItr-m_component_names.begin();
+}
+
+void HIJESUncertaintyProvider::GetUncertaintyComponent(int handle, const float* pt, const float* eta, 
+						       size_t n, float* out) const
+{
+  const TableInfo* info=m_table_info + handle*m_n_eta_bins;
+  for(size_t i=0; i<n; i++) out[i]=EvalTable(info[LookupEtaBinFast(eta[i])],pt[i]*m_GeV);
 }
 
 void HIJESUncertaintyProvider::ListUncertaintyComponentKeys() const
 {
   std::cout << "Listing uncertainty components:" << std::endl;
-  for(map_t::const_iterator mItr=m_uncertainty_graphs.begin(); mItr!=m_uncertainty_graphs.end(); mItr++)
+  for(unsigned int i=0; i<m_component_names.size(); i++)
   {
-    std::cout << std::setw(50) << mItr->first << std::endl;
+    std::cout << std::setw(50) << m_component_names[i] << std::endl;
   }
 }
 
 void HIJESUncertaintyProvider::GetUncertaintyComponentKeys(std::vector<std::string>& vec) const
 {
-  for(map_t::const_iterator mItr=m_uncertainty_graphs.begin(); mItr!=m_uncertainty_graphs.end(); mItr++)
+  for(unsigned int i=0; i<m_component_names.size(); i++)
   {
-    vec.push_back(mItr->first);
+    vec.push_back(m_component_names[i]);
   }
 }
 
@@ -128,10 +351,10 @@ float HIJESUncertaintyProvider::GetTotalUncertainty(float pt, float eta) const
   float kine_lim=2760./std::cosh(eta);
   float pt_1=pt;
   if(pt > kine_lim) pt_1=kine_lim;
-  for(map_t::const_iterator mItr=m_uncertainty_graphs.begin(); mItr!=m_uncertainty_graphs.end(); mItr++)
+  for(int handle=0; handle<(int)m_component_names.size(); handle++)
   {
-    if(mItr->first.compare("baseline")==0 && m_use_JES_tool) continue;
-    float uncert=mItr->second.at(eta_bin)->Eval(pt_1*m_GeV);
+    if(handle==m_baseline_handle && m_use_JES_tool) continue;
+    float uncert=EvalTable(m_table_info[handle*m_n_eta_bins + eta_bin],pt_1*m_GeV);
     total+=uncert*uncert;
   }
   return std::sqrt(total);
@@ -141,8 +364,104 @@ float HIJESUncertaintyProvider::GetTotalUncertainty(float pt, float eta) const
 
 unsigned int HIJESUncertaintyProvider::LookupEtaBin(float eta) const
 {
-  int eta_bin=m_eta_axis->FindBin(GetSign(eta));
-  if(eta_bin > m_eta_axis->GetNbins()) return m_eta_axis->GetNbins()-1;
-  if(eta_bin==0) return 0;
-  else return eta_bin-1;
+  return LookupEtaBinFast(eta);
+}
+
+void HIJESUncertaintyProvider::BuildTables()
+{
+  m_component_names.clear();
+  for(map_t::const_iterator mItr=m_uncertainty_graphs.begin(); mItr!=m_uncertainty_graphs.end(); mItr++)
+    m_component_names.push_back(mItr->first);
+  m_baseline_handle=GetComponentHandle("baseline");
+
+  m_n_eta_bins=m_eta_axis->GetNbins();
+  m_eta_edges.resize(m_n_eta_bins+1);
+  for(int i=0; i<=m_n_eta_bins; i++) m_eta_edges[i]=m_eta_axis->GetBinLowEdge(i+1);
+
+  unsigned int nTables=m_component_names.size()*m_n_eta_bins;
+  m_table_info_store.assign(nTables,TableInfo());
+  m_table_store.clear();
+  m_cell_store.clear();
+
+  std::vector<std::pair<double,double> > points;
+  for(unsigned int handle=0; handle<m_component_names.size(); handle++)
+  {
+    const std::vector<TGraph*>& graphs=m_uncertainty_graphs.find(m_component_names[handle])->second;
+    for(int eta_bin=0; eta_bin<m_n_eta_bins; eta_bin++)
+    {
+      TableInfo& t=m_table_info_store[handle*m_n_eta_bins + eta_bin];
+      const TGraph* g=graphs.at(eta_bin);
+      int np=g->GetN();
+
+      points.resize(np);
+      for(int i=0; i<np; i++) points[i]=std::make_pair(g->GetX()[i],g->GetY()[i]);
+      std::sort(points.begin(),points.end());
+
+      t.offset=m_table_store.size();
+      t.nPoints=np;
+      t.cellOffset=m_cell_store.size();
+      t.nCells=0;
+      t.xMin=t.xMax=t.invStep=0;
+      for(int i=0; i<np; i++)
+      {
+	double slope=0;
+	if(np > 1)
+	{
+	  int lo=std::min(i,np-2);
+	  slope=(points[lo+1].second-points[lo].second)/(points[lo+1].first-points[lo].first);
+	}
+	m_table_store.push_back(points[i].first);
+	m_table_store.push_back(points[i].second);
+	m_table_store.push_back(slope);
+      }
+      if(np < 2) continue;
+
+      // a few cells per segment, each starts at the segment of its low edge
+      t.xMin=points.front().first;
+      t.xMax=points.back().first;
+      t.nCells=4*(np-1);
+      double step=(points.back().first-points.front().first)/t.nCells;
+      t.invStep=1./step;
+      int seg=0;
+      for(int c=0; c<t.nCells; c++)
+      {
+	double x=points.front().first+c*step;
+	while(seg < np-2 && points[seg+1].first <= x) seg++;
+	m_cell_store.push_back(seg);
+      }
+    }
+  }
+  m_table_info=m_table_info_store.data();
+  m_tables=m_table_store.data();
+  m_cells=m_cell_store.data();
+
+  // check against the graphs at the points, cell edges and in between
+  m_table_deviation=0;
+  for(unsigned int handle=0; handle<m_component_names.size(); handle++)
+  {
+    const std::vector<TGraph*>& graphs=m_uncertainty_graphs.find(m_component_names[handle])->second;
+    for(int eta_bin=0; eta_bin<m_n_eta_bins; eta_bin++)
+    {
+      const TableInfo& t=m_table_info[handle*m_n_eta_bins + eta_bin];
+      const TGraph* g=graphs.at(eta_bin);
+      std::vector<double> x_check(g->GetX(),g->GetX()+g->GetN());
+      for(int c=0; c<=t.nCells; c++) x_check.push_back(t.xMin+(c+0.5)/t.invStep);
+      for(unsigned int i=0; i<x_check.size(); i++)
+      {
+	float x=x_check[i];
+	m_table_deviation=std::max(m_table_deviation,(float)std::abs(EvalTable(t,x)-g->Eval(x)));
+      }
+    }
+  }
+
+  std::cout << std::setw(40) << "HIJESUncertaintyProvider : Tables for " << m_component_names.size()
+	    << " components x " << m_n_eta_bins << " eta bins, " << m_table_store.size()/3 << " points, "
+	    << "max deviation from TGraph::Eval " << m_table_deviation << std::endl;
+  if(m_table_deviation > m_table_tolerance)
+  {
+    std::ostringstream message;
+    message << "HIJESUncertaintyProvider : Table deviation " << m_table_deviation
+	    << " above tolerance " << m_table_tolerance;
+    throw std::runtime_error(message.str());
+  }
 }
@@ -10,9 +10,17 @@
  */
 
 #include "JetAnalysis/JetAnalysis.h"
+#include "JetAnalysis/CalibratedJetPool.h"
+#include "JetAnalysis/SystematicFanOut.h"
+#include "JetAnalysis/JetMatcher.h"
+#include "JetAnalysis/ResponseHistograms.h"
+#include "JetAnalysis/PreCalibrationFilter.h"
+
+#include "YKAnalysis/EtaPhiGrid.h"
+#include "YKAnalysis/Kinematics.h"
+#include "YKAnalysis/TrackCache.h"
 
 #include <xAODJet/JetContainer.h>
-#include <xAODCore/AuxContainerBase.h>
 #include <xAODTruth/TruthEventContainer.h>
 #include <xAODTruth/TruthParticleContainer.h>
 
@@ -26,6 +34,13 @@
 #include <InDetTrackSelectionTool/InDetTrackSelectionTool.h>
 
 #include <TMath.h>
+#include <TParameter.h>
+#include <TBranch.h>
+#include <TList.h>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
 
 /** @brief Default Constructor for Fluctuation Analysis.
  */
@@ -47,6 +62,28 @@ JetAnalysis :: JetAnalysis :: JetAnalysis ( const std::string& name  )
   m_jetUncertaintyTool   = NULL;
   m_hiJetUncertaintyTool = NULL; 
   m_trackSelectorTool    = NULL;
+
+  m_trackGrid            = NULL;
+  m_calibJetPool         = NULL;
+  m_preCalibFilter       = NULL;
+
+  m_hiFlavCompositionHandle = -1;
+  m_hiFlavResponseHandle    = -1;
+
+  m_sysUncertFlat        = false;
+  m_sysUncertPrecision   = 0;
+  m_nSysJets             = 0;
+  m_sysCapacity          = 0;
+  m_nSysSaturated        = 0;
+
+  m_jetMatcher           = NULL;
+  m_sysJetMatcher        = NULL;
+  m_responseHists        = NULL;
+  m_doResponseHists      = false;
+
+  m_sysFanOut            = NULL;
+  m_doSysFanOut          = false;
+  m_sysFanOutPtFactor    = 1;
 }
 
 /** @brief Destructor for Fluctuation Analysis.
@@ -61,11 +98,25 @@ JetAnalysis :: JetAnalysis :: ~JetAnalysis()
   delete m_jetUncertaintyTool;
   delete m_hiJetUncertaintyTool;
   delete m_trackSelectorTool;
+  delete m_trackGrid;
+  delete m_calibJetPool;
+  delete m_sysFanOut;
+  delete m_jetMatcher;
+  delete m_sysJetMatcher;
+  delete m_responseHists;
+  delete m_preCalibFilter;
   m_jetCleaningTool      = NULL;
   m_jetCalibrationTool   = NULL;
   m_jetUncertaintyTool   = NULL;
   m_hiJetUncertaintyTool = NULL; 
   m_trackSelectorTool    = NULL;
+  m_trackGrid            = NULL;
+  m_calibJetPool         = NULL;
+  m_sysFanOut            = NULL;
+  m_jetMatcher           = NULL;
+  m_sysJetMatcher        = NULL;
+  m_responseHists        = NULL;
+  m_preCalibFilter       = NULL;
 }
 
 /** @brief Setup method for Jet Analysis
@@ -99,6 +150,50 @@ xAOD::TReturnCode JetAnalysis :: JetAnalysis :: Setup ()
   m_nSysUncert_pp     = config->GetValue( "nSystematics_pp", 17 );
   m_nSysUncert_HI     = config->GetValue( "nSystematics_HI", 2  );
 
+  // "nested" : v_sysUncert, vector< vector<float> > per jet 
+  // "flat"   : sysUncert_<i>[nSysJets], one branch per component
+  // in the flat layout a precision > 0 stores int16, value = stored * precision
+  m_sysUncertFlat      = std::string( config->GetValue( "sysUncertLayout", "nested" ) ) == "flat";
+  m_sysUncertPrecision = config->GetValue( "sysUncertQuantize", 0. );
+
+  // MC only. Jets down to jetPtMin * factor are candidates, 
+  // kept if any JES variation puts them above jetPtMin
+  m_doSysFanOut        = config->GetValue( "doSysFanOut"      , false );
+  m_sysFanOutPtFactor  = config->GetValue( "sysFanOutPtFactor", 0.8   );
+
+  // truth - reco (MC) and trigger - offline (data) matching
+  // "none", "greedy" or "optimal", within jetMatchDR
+  std::string matchStrategy = config->GetValue( "jetMatchStrategy", "none" );
+  if( matchStrategy != "none" ){
+    JetMatcher::Strategy strategy;
+    if( !JetMatcher::GetStrategy( matchStrategy, strategy ) ){
+      std::cout << m_analysisName << " : Unknown jetMatchStrategy " << matchStrategy << std::endl;
+      return xAOD::TReturnCode::kFailure;
+    }
+    m_jetMatcher = new JetMatcher
+      ( config->GetValue( "jetMatchDR", 0.5 * m_jetRparameter ), strategy );
+  }
+
+  // skip calibration of jets whose EM scale pT cannot pass the cut.
+  // Bound learned on the first preCalibWarmupEvents events, then
+  // checked on every preCalibSampleEvery-th skippable jet.
+  // preCalibVerify calibrates all jets and checks the bound instead
+  if( config->GetValue( "doPreCalibFilter", false ) ){
+    m_preCalibFilter = new PreCalibrationFilter
+      ( config->GetValue( "preCalibWarmupEvents", 100  ),
+	config->GetValue( "preCalibMargin"      , 0.05 ),
+	config->GetValue( "preCalibVerify"      , false ),
+	config->GetValue( "preCalibSampleEvery" , 100  ) );
+  }
+
+  // response matrices in the event loop (MC), from matched
+  // truth - reco pairs. Needs a matcher, greedy if none set
+  m_doResponseHists = !m_isData && config->GetValue( "doResponseHistograms", false );
+  if( m_doResponseHists && !m_jetMatcher ){
+    m_jetMatcher = new JetMatcher
+      ( config->GetValue( "jetMatchDR", 0.5 * m_jetRparameter ), JetMatcher::kGreedy );
+  }
+
   return xAOD::TReturnCode::kSuccess;
 }
 
@@ -116,34 +211,88 @@ xAOD::TReturnCode JetAnalysis :: JetAnalysis :: HistInitialize ()
 
   // Reco jets  
   m_sd->AddOutputToTree< std::vector<TLorentzVector> >
-    ("vR_C_jets"  , &vR_C_jets );
+    ("vR_C_jets"  , &vR_C_jets, m_outputTreeName );
 
   // Truth jets. Only in MC
   if( !m_isData )
     {m_sd->AddOutputToTree< std::vector<TLorentzVector> >
-	("vT_jets" , &vT_jets); }
+	("vT_jets" , &vT_jets, m_outputTreeName); }
 
   // Trigger jets. Only in Data
   if( m_isData )
     { m_sd->AddOutputToTree< std::vector<TLorentzVector> >
-	("vTrig_jets" , &vTrig_jets); }
+	("vTrig_jets" , &vTrig_jets, m_outputTreeName); }
 
   m_sd->AddOutputToTree< std::vector<double> >
-    ("vRtrk1", &vRtrk1 );
+    ("vRtrk1", &vRtrk1, m_outputTreeName );
 
   m_sd->AddOutputToTree< std::vector<double> >
-    ("vRtrk2", &vRtrk2 );
+    ("vRtrk2", &vRtrk2, m_outputTreeName );
 
   m_sd->AddOutputToTree< std::vector<double> >
-    ("vRtrk4", &vRtrk4 );
+    ("vRtrk4", &vRtrk4, m_outputTreeName );
 
   m_sd->AddOutputToTree< std::vector<bool> >
-    ("v_isCleanJet", &v_isCleanJet );
+    ("v_isCleanJet", &v_isCleanJet, m_outputTreeName );
+
+  // matched reco jet for each truth / trigger jet
+  if( m_jetMatcher && !m_isData ){
+    m_sd->AddOutputToTree< std::vector<int> >
+      ("vT_matchIndex"  , &vT_matchIndex  , m_outputTreeName );
+    m_sd->AddOutputToTree< std::vector<float> >
+      ("vT_matchDR"     , &vT_matchDR     , m_outputTreeName );
+    m_sd->AddOutputToTree< std::vector<float> >
+      ("vT_matchPtRatio", &vT_matchPtRatio, m_outputTreeName );
+  } else if( m_jetMatcher ){
+    m_sd->AddOutputToTree< std::vector<int> >
+      ("vTrig_matchIndex"  , &vTrig_matchIndex  , m_outputTreeName );
+    m_sd->AddOutputToTree< std::vector<float> >
+      ("vTrig_matchDR"     , &vTrig_matchDR     , m_outputTreeName );
+    m_sd->AddOutputToTree< std::vector<float> >
+      ("vTrig_matchPtRatio", &vTrig_matchPtRatio, m_outputTreeName );
+  }
 
   // add uncertainty unc
-  if( !m_isData )
+  if( !m_isData && !m_sysUncertFlat )
     { m_sd->AddOutputToTree< std::vector<std::vector<float> > >
-	("v_sysUncert", &v_sysUncert); }
+	("v_sysUncert", &v_sysUncert, m_outputTreeName); }
+  else if( !m_isData ){
+    m_sd->AddOutputArrayToTree( "nSysJets", &m_nSysJets, "nSysJets/I", m_outputTreeName );
+    bool quantize = m_sysUncertPrecision > 0;
+    ReserveSysUncert( 64 );
+    for( int component = 0; component < m_nSysUncert; component++ ){
+      std::string name = Form( "sysUncert_%i", component );
+      void* address = quantize ?
+	(void*)&m_v_sysUncertQ   [ component * m_sysCapacity ] :
+	(void*)&m_v_sysUncertFlat[ component * m_sysCapacity ] ;
+      TBranch* branch = m_sd->AddOutputArrayToTree
+	( name, address, name + "[nSysJets]" + ( quantize ? "/S" : "/F" ), m_outputTreeName );
+      m_v_sysBranches.push_back( branch );
+    }
+    // value = stored * precision, kept with the tree. -32768 is NaN
+    if( quantize ){
+      m_sd->GetOutputTree( m_outputTreeName )->GetUserInfo()->Add
+	( new TParameter<float>( "sysUncertPrecision", m_sysUncertPrecision ) );
+    }
+  }
+
+  // JES variations, pT and selection per variation
+  if( !m_isData && m_doSysFanOut ){
+    m_sysFanOut = new SystematicFanOut( m_nSysUncert, m_jetPtMin );
+    m_sysFanOut->AddBranches( m_sd, m_outputTreeName );
+  }
+
+  // nominal, and each fan out variation if on
+  if( m_doResponseHists ){
+    m_responseHists = new ResponseHistograms
+      ( m_sysFanOut ? m_sysFanOut->GetNVariations() : 0, m_sd->GetConfig() );
+    m_responseHists->Register( m_sd );
+    // variations are matched among their own passing jets
+    if( m_sysFanOut ){
+      m_sysJetMatcher = new JetMatcher
+	( m_jetMatcher->GetMaxDR(), m_jetMatcher->GetStrategy() );
+    }
+  }
 
   return xAOD::TReturnCode::kSuccess;
 }
@@ -161,12 +310,16 @@ xAOD::TReturnCode JetAnalysis :: JetAnalysis :: Initialize ()
 
   const char* statusL = Form("%s::initialize",m_analysisName.c_str() ); 
 
+  TStopwatch sw;
+  sw.Start();
+
   // ----- Jet Cleaning
   m_jetCleaningTool = new JetCleaningTool("JetCleaning");
   m_jetCleaningTool->msg().setLevel( MSG::DEBUG ); 
   CHECK_STATUS( statusL, m_jetCleaningTool->setProperty( "CutLevel", "LooseBad"));
   CHECK_STATUS( statusL, m_jetCleaningTool->setProperty("DoUgly", false));
   CHECK_STATUS( statusL, m_jetCleaningTool->initialize() );
+  printInitTime( m_analysisName, "JetCleaningTool", sw );
 
   // ----- Jet Calibration
   const std::string name    = "JetAnalysis";       //string describing the current thread, for logging
@@ -186,6 +339,63 @@ xAOD::TReturnCode JetAnalysis :: JetAnalysis :: Initialize ()
   // Initialize the tool
   std::cerr  << jetAlgorithm << " " << config << " " << calibSeq << " " << isData << std::endl;
   CHECK_STATUS( statusL, m_jetCalibrationTool->initializeTool(name) );
+  printInitTime( m_analysisName, "JetCalibrationTool", sw );
+
+  // ----- JES (pp, HI)
+  // Only needed for systematics on MC. These are
+  // created on first use, see InitializeUncertaintyTools.
+
+  // ----- Track Selector Tool
+  // Call Constructor
+  m_trackSelectorTool = new InDet::InDetTrackSelectionTool("InDetTrackSelectorTool");
+  CHECK_STATUS( statusL, m_trackSelectorTool->setProperty("CutLevel","TightPrimary"));
+  CHECK_STATUS( statusL, m_trackSelectorTool->setProperty("maxZ0SinTheta",1.0));
+  CHECK_STATUS( statusL, m_trackSelectorTool->setProperty("minPt",1.));
+  CHECK_STATUS( statusL, m_trackSelectorTool->setProperty("maxNSiSharedHits",100));
+  CHECK_STATUS( statusL, m_trackSelectorTool->initialize());
+  printInitTime( m_analysisName, "InDetTrackSelectionTool", sw );
+
+  // tracks are selected once per event in the shared track cache
+  m_sd->GetTrackCache()->SetSelectionTool( m_trackSelectorTool );
+
+  m_trackQuality = YKAnalysis::TrackCache::kAcceptance;
+  if( m_sd->GetConfig()->GetValue( "applyTrackSelection", true ) )
+    { m_trackQuality |= YKAnalysis::TrackCache::kSelected; }
+
+  // ----- Track - jet association
+  // tracks in the tracker (|eta|<2.5) binned in cells about the
+  // size of the jet. Sums for track pT > 1, 2, 4 GeV in jet radius
+  double trackGridCellSize = 
+    m_sd->GetConfig()->GetValue( "trackGridCellSize", m_jetRparameter );
+  m_trackGrid = new YKAnalysis::EtaPhiGrid( 2.5, trackGridCellSize );
+
+  m_v_trkConeR.clear();
+  m_v_trkConeR.push_back( m_jetRparameter );
+
+  m_v_trkPtThresholds.clear();
+  m_v_trkPtThresholds.push_back( 1000. ); // 1 GeV
+  m_v_trkPtThresholds.push_back( 2000. ); // 2 GeV
+  m_v_trkPtThresholds.push_back( 4000. ); // 4 GeV
+
+  // ----- Calibrated jets
+  m_calibJetPool = new CalibratedJetPool();
+
+  return xAOD::TReturnCode::kSuccess;
+}
+
+/** @brief Initialize the JES uncertainty tools.
+ *
+ *  Called on first use, so jobs without systematics
+ *  (data, or doSystematics off) never pay for these.
+ *
+ *  @return xAOD::TReturnCode 
+ */
+xAOD::TReturnCode JetAnalysis :: JetAnalysis :: InitializeUncertaintyTools () 
+{
+  const char* statusL = Form("%s::initialize",m_analysisName.c_str() ); 
+
+  TStopwatch sw;
+  sw.Start();
 
   // ----- JES (pp)
   // Call Constructor
@@ -196,21 +406,27 @@ xAOD::TReturnCode JetAnalysis :: JetAnalysis :: Initialize ()
 		("ConfigFile","JES_2015/ICHEP2016/JES2015_19NP.config") );
   // Initialize the tool
   CHECK_STATUS( statusL, m_jetUncertaintyTool->initialize() );
+  printInitTime( m_analysisName, "JetUncertaintiesTool", sw );
 
   // ----- JES (HI)
   // Call Constructor
-  m_hiJetUncertaintyTool = new HIJESUncertaintyProvider("HIJESUncert_data15_5TeV.root");
+  // throws if its lookup tables do not reproduce the graphs
+  try{
+    m_hiJetUncertaintyTool = new HIJESUncertaintyProvider
+      ("HIJESUncert_data15_5TeV.root", m_sd->GetConfig()->GetValue( "hiJESTableTolerance", 1e-5 ) );
+  } catch( const std::runtime_error& e ){
+    std::cout << statusL << " : " << e.what() << std::endl;
+    return xAOD::TReturnCode::kFailure;
+  }
   m_hiJetUncertaintyTool->UseJESTool(true);
   m_hiJetUncertaintyTool->UseGeV(false);
-
-  // ----- Track Selector Tool
-  // Call Constructor
-  m_trackSelectorTool = new InDet::InDetTrackSelectionTool("InDetTrackSelectorTool");
-  CHECK_STATUS( statusL, m_trackSelectorTool->setProperty("CutLevel","TightPrimary"));
-  CHECK_STATUS( statusL, m_trackSelectorTool->setProperty("maxZ0SinTheta",1.0));
-  CHECK_STATUS( statusL, m_trackSelectorTool->setProperty("minPt",1.));
-  CHECK_STATUS( statusL, m_trackSelectorTool->setProperty("maxNSiSharedHits",100));
-  CHECK_STATUS( statusL, m_trackSelectorTool->initialize());
+  m_hiFlavCompositionHandle = m_hiJetUncertaintyTool->GetComponentHandle("flav_composition");
+  m_hiFlavResponseHandle    = m_hiJetUncertaintyTool->GetComponentHandle("flav_response");
+  if( m_hiFlavCompositionHandle < 0 || m_hiFlavResponseHandle < 0 ){
+    std::cout << statusL << " : HI JES flavor components not found" << std::endl;
+    return xAOD::TReturnCode::kFailure;
+  }
+  printInitTime( m_analysisName, "HIJESUncertaintyProvider", sw );
 
   return xAOD::TReturnCode::kSuccess;
 }
@@ -255,6 +471,7 @@ xAOD::TReturnCode JetAnalysis :: JetAnalysis :: ProcessEvent(){
   vR_C_jets   .clear();
   vT_jets     .clear(); 
   v_sysUncert .clear();
+  m_nSysJets = 0;
   v_isCleanJet.clear();
   vRtrk1      .clear();
   vRtrk2      .clear();
@@ -269,76 +486,95 @@ xAOD::TReturnCode JetAnalysis :: JetAnalysis :: ProcessEvent(){
 
   if( m_sd->DoPrint() ) 
     printf("%s  :  %i ", m_recoJetContainer.c_str(), (int)recoJets->size() );
+
+  //Tracks, selected once per event in the shared cache, 
+  //binned in eta-phi
+  YKAnalysis::TrackCache* trackCache = m_sd->GetTrackCache();
+  CHECK_STATUS( statusL, trackCache->Retrieve( eventStore ) );
+  trackCache->Select( m_trackQuality, m_v_trkEta, m_v_trkPhi, m_v_trkPt );
+
+  m_trackGrid->Build( m_v_trkEta.data(), m_v_trkPhi.data(), 
+		      m_v_trkPt.data() , m_v_trkPt.size() );
   
-  // Create the new container and its auxiliary store.
-  xAOD::JetContainer*     calibRecoJets    = new xAOD::JetContainer();
-  xAOD::AuxContainerBase* calibRecoJetsAux = new xAOD::AuxContainerBase();
-  calibRecoJets->setStore( calibRecoJetsAux ); //< Connect the two
+  // Calibrated copies live in a pool that is reused every event
+  m_calibJetPool->Reset();
+
+  if( isMC && m_doSystematics && m_sysUncertFlat )
+    { ReserveSysUncert( recoJets->size() ); }
+
+  bool doFanOut = isMC && m_sysFanOut;
+  if( doFanOut ){ m_sysFanOut->Reset( recoJets->size() ); }
+  float jetPtMin = doFanOut ? m_jetPtMin * m_sysFanOutPtFactor : m_jetPtMin;
+
+  if( m_preCalibFilter ){ m_preCalibFilter->StartEvent(); }
 
   for( const auto& jet : *recoJets ){
+    const xAOD::JetFourMom_t pileupscale_jetP4 = jet->jetP4("JetEMScaleMomentum");
+
+    // cannot pass the cut even with the largest response seen
+    bool canSkip = m_preCalibFilter &&
+      m_preCalibFilter->CanSkip( pileupscale_jetP4.pt(), pileupscale_jetP4.eta(), jetPtMin );
+    if( canSkip && !m_preCalibFilter->IsVerifying() && !m_preCalibFilter->Sample() ){
+      m_preCalibFilter->Skip();
+      continue;
+    }
+
     bool isCleanJet = m_jetCleaningTool->accept( *jet );
     
-    xAOD::Jet* newJet = new xAOD::Jet();
-    newJet->makePrivateStore( *jet );
+    xAOD::Jet* newJet = m_calibJetPool->Acquire( *jet );
 
-    const xAOD::JetFourMom_t pileupscale_jetP4 = newJet->jetP4("JetEMScaleMomentum");
     newJet->setJetP4( "JetPileupScaleMomentum", pileupscale_jetP4 );
     
     CHECK_STATUS( statusL, m_jetCalibrationTool->applyCalibration( *newJet ) ); 
 
+    if( m_preCalibFilter )
+      { m_preCalibFilter->Check( pileupscale_jetP4.pt(), pileupscale_jetP4.eta(), 
+				 newJet->pt(), jetPtMin, canSkip ); }
+
     // if the calibrated pT is less than a cut, dont
     // save or do anything else with this jet 
-    if( newJet->pt() < m_jetPtMin ){ continue; }
+    if( newJet->pt() < jetPtMin ){ continue; }
+
+    // evaluate all uncertainties once, keep if
+    // any variation can pass the cut
+    if( doFanOut ){
+      UncertaintyProviderJES( newJet, m_sysFanOut->NextJet( newJet->pt() ), 
+			      m_sysFanOut->GetStride() );
+      if( !m_sysFanOut->CanPass() ){ m_sysFanOut->Drop(); continue; }
+    }
 
-    calibRecoJets->push_back( newJet );
+    m_calibJetPool->Keep();
     v_isCleanJet.push_back( isCleanJet );
 
     // do systematic uncertainties
-    if( isMC && m_doSystematics ){
-      std::vector< float > jet_sys_uncert;
-      jet_sys_uncert.reserve( m_nSysUncert );
-      UncertaintyProviderJES( newJet, jet_sys_uncert );
+    // (already evaluated if fanning out)
+    if( isMC && m_doSystematics && m_sysUncertFlat ){
+      if( doFanOut ){ m_sysFanOut->CopyLastJet( &m_v_sysUncertFlat[ m_nSysJets ], m_sysCapacity ); }
+      else { UncertaintyProviderJES( newJet, &m_v_sysUncertFlat[ m_nSysJets ], m_sysCapacity ); }
+      m_nSysJets++;
+    } else if( isMC && m_doSystematics ){
+      std::vector< float > jet_sys_uncert( m_nSysUncert );
+      if( doFanOut ){ m_sysFanOut->CopyLastJet( jet_sys_uncert.data(), 1 ); }
+      else { UncertaintyProviderJES( newJet, jet_sys_uncert.data() ); }
       v_sysUncert.push_back( jet_sys_uncert );
     }
 
     // Match tracks to jets.
     // add pT of associated tracks pTs to this jet
-    
-    //Tracks
-    const xAOD::TrackParticleContainer* recoTracks = 0;
-    CHECK_STATUS( statusL, eventStore->retrieve( recoTracks, "InDetTrackParticles" ) );
-
-    double trkPtTotal1 = 0;
-    double trkPtTotal2 = 0;
-    double trkPtTotal4 = 0;
-    for (const auto& trk : *recoTracks){
-      // cut on tracks that are not convered by tracker
-      if ( std::fabs( trk->eta() ) >= 2.5 ){ continue; }
-      // check if the track is within the jet radius
-      if ( DeltaR( jet, trk ) > m_jetRparameter ){ continue; }
-      // if we passed these cuts, add the track pT to the
-      // total track pT associated with this jet.
-      // there are three different cuts. on individual track pTs
-      double trkPt = trk->pt();
-
-      /*      
-      if( m_sd->DoPrint() ){
-	std::cout << jet->pt() << " " << jet->eta() << " " << jet->phi() << " " 
-		  << trk->pt() << " " << trk->eta() << " " << trk->phi() << std::endl;
-      }
-      */
-
-      if( trkPt > 1000. ){ trkPtTotal1 += trkPt; } // 1 GeV
-      if( trkPt > 2000. ){ trkPtTotal2 += trkPt; } // 2 GeV
-      if( trkPt > 4000. ){ trkPtTotal4 += trkPt; } // 4 GeV
-    }
+    // there are three different cuts. on individual track pTs
+    m_trackGrid->SumInCones( jet->eta(), jet->phi(), 
+			     m_v_trkConeR, m_v_trkPtThresholds, m_v_trkPtSums );
   
     // add the track pt info here 
-    vRtrk1.push_back( trkPtTotal1 );
-    vRtrk2.push_back( trkPtTotal2 );
-    vRtrk4.push_back( trkPtTotal4 );
+    vRtrk1.push_back( m_v_trkPtSums[0] );
+    vRtrk2.push_back( m_v_trkPtSums[1] );
+    vRtrk4.push_back( m_v_trkPtSums[2] );
   
   } // end for loop over jets
+
+  if( m_sysUncertFlat && m_sysUncertPrecision > 0 && m_nSysJets ){ QuantizeSysUncert(); }
+
+  if( doFanOut ){ m_sysFanOut->Compute(); }
  
   // get the truth containter (jets)
   if( isMC ){
@@ -351,24 +587,27 @@ xAOD::TReturnCode JetAnalysis :: JetAnalysis :: ProcessEvent(){
 
   //-------------------------------
   
+  const xAOD::JetContainer* calibRecoJets = m_calibJetPool->GetContainer();
+
   // MC
   // Save Truth and Reco
   if( isMC ){
     SaveJets( calibRecoJets, vR_C_jets );
     SaveJets( truthJets, vT_jets, m_jetPtMin ); 
+    // with fan out, reco jets below jetPtMin are kept,
+    // nominal matches only to those passing the nominal cut
+    if( m_jetMatcher )
+      { m_jetMatcher->Match( vT_jets, vR_C_jets, 
+			     vT_matchIndex, vT_matchDR, vT_matchPtRatio,
+			     doFanOut ? m_sysFanOut->GetPassNominal() : NULL ); }
+    if( m_responseHists ){ FillResponse(); }
   } 			
   // DATA
-  // no pairing for data since no truth jets just save them
+  // no truth jets, just save them. Matched to trigger below
   else if( isData ){
     SaveJets( calibRecoJets, vR_C_jets );
   } 
   
-  // delete the deep copies
-  delete calibRecoJets;
-  delete calibRecoJetsAux;
-  calibRecoJets    = NULL;
-  calibRecoJetsAux = NULL;  
-  
   //-------------------------------    
   // TRIGGER JETS                                                            
   //-------------------------------  
@@ -387,6 +626,9 @@ xAOD::TReturnCode JetAnalysis :: JetAnalysis :: ProcessEvent(){
       printf("%s  :  %i", m_recoJetContainer.c_str(), (int)recoJets->size() );
    
     SaveJets( trigJets, vTrig_jets, m_jetPtMin ); 
+    if( m_jetMatcher )
+      { m_jetMatcher->Match( vTrig_jets, vR_C_jets, 
+			     vTrig_matchIndex, vTrig_matchDR, vTrig_matchPtRatio ); }
   }
 
   return xAOD::TReturnCode::kSuccess;
@@ -402,7 +644,21 @@ xAOD::TReturnCode JetAnalysis :: JetAnalysis :: Finalize()
 {
   std::cout << m_analysisName << " Finalizing" << std::endl;
 
+  if( m_calibJetPool ) m_calibJetPool->Print( m_analysisName );
+  if( m_sysFanOut    ) m_sysFanOut   ->Print( m_analysisName );
+  if( m_preCalibFilter ) m_preCalibFilter->Print( m_analysisName );
+  if( m_jetMatcher   ) 
+    { std::cout << m_analysisName << " : JetMatcher matched " 
+		<< m_jetMatcher->GetNMatched() << " of " 
+		<< m_jetMatcher->GetNFrom() << " jets" << std::endl; }
+
+  if( m_nSysSaturated )
+    { std::cout << m_analysisName << " : " << m_nSysSaturated 
+		<< " systematic uncertainties saturated int16 or NaN at precision "
+		<< m_sysUncertPrecision << std::endl; }
+
   // tools
+  m_sd->GetTrackCache()->SetSelectionTool( NULL );
   delete m_jetCleaningTool;
   delete m_jetCalibrationTool;
   delete m_jetUncertaintyTool;
@@ -428,9 +684,25 @@ xAOD::TReturnCode JetAnalysis :: JetAnalysis :: HistFinalize()
   return xAOD::TReturnCode::kSuccess;
 }
 
+/** @brief Fill systematic uncertainties of a jet
+ *
+ *  Component i is written to v_uncert[ i * stride ],
+ *  so the same code fills a per jet array (stride 1)
+ *  or a column of the flat component-major array.
+ *
+ *  @param1 Calibrated jet
+ *  @param2 Output array
+ *  @param3 Stride between components
+ *
+ *  @return void
+ */
 void JetAnalysis :: JetAnalysis :: UncertaintyProviderJES
 ( const xAOD::Jet* jet,
-  std::vector<float>& v_uncert ){
+  float* v_uncert, int stride ){
+
+  if( !m_jetUncertaintyTool ){
+    CHECK_STATUS( Form("%s::execute",m_analysisName.c_str() ), InitializeUncertaintyTools() );
+  }
 
   for( int component = 0; component < m_nSysUncert; component++ ){
     double jetPt  = jet->pt();
@@ -440,7 +712,7 @@ void JetAnalysis :: JetAnalysis :: UncertaintyProviderJES
     // if a pp factor, just use this, and continue to next
     if( component < m_nSysUncert_pp ){ 
       uncertainty = m_jetUncertaintyTool->getUncertainty( component,(*jet) );
-      v_uncert.push_back( uncertainty );
+      v_uncert[ component * stride ] = uncertainty;
       continue; 
     }
 
@@ -449,15 +721,101 @@ void JetAnalysis :: JetAnalysis :: UncertaintyProviderJES
     if ( component == m_nSysUncert_pp ){
       HIJESuncertainty = 
 	sqrt(pow( m_hiJetUncertaintyTool->GetUncertaintyComponent
-		 ("flav_composition",jetPt, jetEta),2) + 
+		 (m_hiFlavCompositionHandle,jetPt, jetEta),2) + 
 	     pow( m_hiJetUncertaintyTool->GetUncertaintyComponent
-		 ("flav_response",jetPt, jetEta),2));
+		 (m_hiFlavResponseHandle,jetPt, jetEta),2));
     } else if ( component == m_nSysUncert_pp + 1 ) {
       // for now, the above doesnt work. histograms are bad
       HIJESuncertainty = 0;
     }
    
-    v_uncert.push_back( HIJESuncertainty );
+    v_uncert[ component * stride ] = HIJESuncertainty;
+  }
+}
+
+/** @brief Make room for the flat uncertainty arrays
+ *
+ *  Grows only, so after the first few events there are
+ *  no allocations. When the arrays move, the branch 
+ *  addresses are updated.
+ *
+ *  @param1 Number of jets
+ *
+ *  @return void
+ */
+void JetAnalysis :: JetAnalysis :: ReserveSysUncert( std::size_t nJets )
+{
+  if( nJets <= m_sysCapacity ) return;
+  m_sysCapacity = std::max( nJets, 2 * m_sysCapacity );
+
+  m_v_sysUncertFlat.assign( m_nSysUncert * m_sysCapacity, 0 );
+  if( m_sysUncertPrecision > 0 )
+    { m_v_sysUncertQ.assign( m_nSysUncert * m_sysCapacity, 0 ); }
+
+  for( std::size_t component = 0; component < m_v_sysBranches.size(); component++ ){
+    void* address = m_sysUncertPrecision > 0 ?
+      (void*)&m_v_sysUncertQ   [ component * m_sysCapacity ] :
+      (void*)&m_v_sysUncertFlat[ component * m_sysCapacity ] ;
+    m_v_sysBranches[ component ]->SetAddress( address );
+  }
+}
+
+/** @brief Convert flat uncertainties to int16
+ *
+ *  Rounds to the nearest multiple of the precision.
+ *  Values out of range are clamped and counted.
+ *  NaN is stored as -32768 and counted with them.
+ *
+ *  @return void
+ */
+void JetAnalysis :: JetAnalysis :: QuantizeSysUncert()
+{
+  const float invPrecision = 1. / m_sysUncertPrecision;
+  for( int component = 0; component < m_nSysUncert; component++ ){
+    const float* in  = &m_v_sysUncertFlat[ component * m_sysCapacity ];
+    Short_t*     out = &m_v_sysUncertQ   [ component * m_sysCapacity ];
+    for( int jet = 0; jet < m_nSysJets; jet++ ){
+      if( std::isnan( in[ jet ] ) ){ out[ jet ] = -32768; m_nSysSaturated++; continue; }
+      float q = std::floor( in[ jet ] * invPrecision + 0.5 );
+      if( q >  32767 ){ q =  32767; m_nSysSaturated++; }
+      if( q < -32767 ){ q = -32767; m_nSysSaturated++; }
+      out[ jet ] = (Short_t)q;
+    }
+  }
+}
+
+/** @brief Fill response histograms
+ *
+ *  For each truth jet, with its matched reco jet
+ *  (nominal pT and pT of each fan out variation).
+ *  Nominal uses the truth matches of the event, made
+ *  among reco jets passing the nominal cut. With fan
+ *  out, each variation is matched again among the reco
+ *  jets passing its own cut. Unmatched is filled as -1.
+ *
+ *  @return void
+ */
+void JetAnalysis :: JetAnalysis :: FillResponse()
+{
+  double fcalEt = m_sd->GetFCalEt();
+  int nVariations = m_responseHists->GetNVariations() - 1;
+
+  for( std::size_t i = 0; i < vT_jets.size(); i++ ){
+    int reco = vT_matchIndex[i];
+    m_responseHists->Fill
+      ( 0, vT_jets[i].Pt() / 1000., reco >= 0 ? vR_C_jets[ reco ].Pt() / 1000. : -1,
+	vT_jets[i].Eta(), fcalEt );
+  }
+
+  for( int v = 0; v < nVariations; v++ ){
+    m_sysJetMatcher->Match( vT_jets, vR_C_jets, m_v_sysMatchIndex, m_v_sysMatchDR,
+			    m_v_sysMatchPtRatio, m_sysFanOut->GetPass(v) );
+    for( std::size_t i = 0; i < vT_jets.size(); i++ ){
+      int reco = m_v_sysMatchIndex[i];
+      m_responseHists->Fill
+	( 1 + v, vT_jets[i].Pt() / 1000., reco >= 0 ? m_sysFanOut->GetPt(v)[ reco ] / 1000. : -1,
+	  vT_jets[i].Eta(), fcalEt );
+    }
   }
 }
 
@@ -465,22 +823,16 @@ void JetAnalysis :: JetAnalysis :: UncertaintyProviderJES
 Float_t JetAnalysis :: JetAnalysis :: DeltaR( const xAOD::Jet* jet1 , 
 					      const xAOD::Jet* jet2 )
 {  
-  Float_t deltaEta = jet1->eta() - jet2->eta();
-  Float_t deltaPhi = TMath::Abs( jet1->phi() - jet2->phi() );
-  if(deltaPhi > TMath::Pi())
-    deltaPhi = 2*TMath::Pi() - deltaPhi;
-  return TMath::Sqrt( deltaEta*deltaEta + deltaPhi*deltaPhi );
+  return YKAnalysis::Kinematics::DeltaR( jet1->eta(), jet1->phi(), 
+					 jet2->eta(), jet2->phi() );
 }
 
 // calculate deltaR = sqrt( deltaphi^2 + deltaeta^2)
 Float_t JetAnalysis :: JetAnalysis :: DeltaR( const xAOD::Jet* jet , 
 					      const xAOD::TrackParticle* track )
 {  
-  Float_t deltaEta = jet->eta() - track->eta();
-  Float_t deltaPhi = TMath::Abs( jet->phi() - track->phi() );
-  if(deltaPhi > TMath::Pi())
-    deltaPhi = 2*TMath::Pi() - deltaPhi;
-  return TMath::Sqrt( deltaEta*deltaEta + deltaPhi*deltaPhi );
+  return YKAnalysis::Kinematics::DeltaR( jet->eta()  , jet->phi(), 
+					 track->eta(), track->phi() );
 }
 
 // save the jets
@@ -0,0 +1,223 @@
+/** @file JetMatcher.cxx
+ *  @brief Implementation of JetMatcher.
+ *
+ *  JetMatcher pairs jets of one collection (i.e. truth
+ *  or trigger) with jets of another (reco) within a maximum
+ *  deltaR. The "to" jets are binned in an EtaPhiGrid, so
+ *  only nearby jets are considered.
+ *
+ *  Greedy  : candidate pairs sorted by deltaR, each
+ *            taken if both jets are still free.
+ *  Optimal : assignment that matches the most jets and,
+ *            among those, has the smallest sum of deltaR
+ *            (Hungarian algorithm on the candidate pairs).
+ *
+ *  @author Yakov Kulinich
+ *  @bug No known bugs.
+ */
+
+#include "JetAnalysis/JetMatcher.h"
+
+#include "YKAnalysis/EtaPhiGrid.h"
+#include "YKAnalysis/Kinematics.h"
+
+#include <algorithm>
+#include <limits>
+
+/** @brief Constructor for JetMatcher.
+ *
+ *  @param1 Maximum deltaR
+ *  @param2 Matching strategy
+ */
+JetAnalysis :: JetMatcher :: JetMatcher ( float maxDR, Strategy strategy )
+  : m_maxDR   ( maxDR ),
+    m_strategy( strategy ),
+    m_grid    ( new YKAnalysis::EtaPhiGrid( 5.0, std::max( maxDR, 0.1f ) ) ),
+    m_nMatched( 0 ),
+    m_nFrom   ( 0 )
+{}
+
+/** @brief Destructor for JetMatcher.
+ */
+JetAnalysis :: JetMatcher :: ~JetMatcher ()
+{
+  delete m_grid;
+}
+
+/** @brief Strategy from name
+ *
+ *  @param1 "greedy" or "optimal"
+ *  @param2 output strategy
+ *
+ *  @return false if name unknown
+ */
+bool JetAnalysis :: JetMatcher :: GetStrategy ( const std::string& name, Strategy& strategy )
+{
+  if     ( name == "greedy"  ){ strategy = kGreedy;  return true; }
+  else if( name == "optimal" ){ strategy = kOptimal; return true; }
+  return false;
+}
+
+/** @brief Match two collections
+ *
+ *  Outputs have the size of the "from" collection.
+ *  With a mask, only "to" jets with a nonzero entry
+ *  are matched to, indices are still those of "to".
+ *
+ *  @param1 Jets to match from
+ *  @param2 Jets to match to
+ *  @param3 Index of matched jet, -1 if none
+ *  @param4 deltaR of match, -1 if none
+ *  @param5 pT ratio (to / from), -1 if none
+ *  @param6 Mask of "to" jets to use, NULL for all
+ *
+ *  @return void
+ */
+void JetAnalysis :: JetMatcher :: Match ( const std::vector< TLorentzVector >& from,
+					  const std::vector< TLorentzVector >& to,
+					  std::vector< int   >& v_index,
+					  std::vector< float >& v_dR,
+					  std::vector< float >& v_ptRatio,
+					  const UChar_t* toPass )
+{
+  int nFrom = from.size();
+  int nTo   = to.size();
+
+  m_v_fromEta.resize( nFrom ); m_v_fromPhi.resize( nFrom );
+  for( int i = 0; i < nFrom; i++ ){
+    m_v_fromEta[i] = from[i].Eta();
+    m_v_fromPhi[i] = from[i].Phi();
+  }
+  m_v_toEta.resize( nTo ); m_v_toPhi.resize( nTo ); m_v_toPt.resize( nTo );
+  for( int j = 0; j < nTo; j++ ){
+    m_v_toEta[j] = to[j].Eta();
+    m_v_toPhi[j] = to[j].Phi();
+    m_v_toPt [j] = to[j].Pt ();
+  }
+
+  // candidate pairs from nearby cells
+  m_grid->Build( m_v_toEta.data(), m_v_toPhi.data(), m_v_toPt.data(), nTo );
+  m_v_pairs.clear();
+  for( int i = 0; i < nFrom; i++ ){
+    m_grid->GetNear( m_v_fromEta[i], m_v_fromPhi[i], m_maxDR, m_v_near );
+    for( auto j : m_v_near ){
+      if( toPass && !toPass[j] ) continue;
+      float dR = YKAnalysis::Kinematics::DeltaR( m_v_fromEta[i], m_v_fromPhi[i],
+						 m_v_toEta[j]  , m_v_toPhi[j] );
+      m_v_pairs.push_back( Pair{ dR, i, j } );
+    }
+  }
+
+  m_v_assignment.assign( nFrom, -1 );
+  if( !m_v_pairs.empty() ){
+    if( m_strategy == kOptimal ) MatchOptimal( nFrom, nTo );
+    else                         MatchGreedy ( nFrom, nTo );
+  }
+
+  v_index  .assign( nFrom, -1 );
+  v_dR     .assign( nFrom, -1 );
+  v_ptRatio.assign( nFrom, -1 );
+  for( int i = 0; i < nFrom; i++ ){
+    int j = m_v_assignment[i];
+    if( j < 0 ) continue;
+    v_index  [i] = j;
+    v_dR     [i] = YKAnalysis::Kinematics::DeltaR( m_v_fromEta[i], m_v_fromPhi[i],
+						   m_v_toEta[j]  , m_v_toPhi[j] );
+    v_ptRatio[i] = from[i].Pt() > 0 ? m_v_toPt[j] / from[i].Pt() : -1;
+    m_nMatched++;
+  }
+  m_nFrom += nFrom;
+}
+
+/** @brief Greedy matching
+ *
+ *  @param1 Number of from jets
+ *  @param2 Number of to jets
+ *
+ *  @return void
+ */
+void JetAnalysis :: JetMatcher :: MatchGreedy ( int /*nFrom*/, int nTo )
+{
+  std::sort( m_v_pairs.begin(), m_v_pairs.end(),
+	     []( const Pair& a, const Pair& b ){ 
+	       if( a.dR != b.dR ) return a.dR < b.dR;
+	       if( a.from != b.from ) return a.from < b.from;
+	       return a.to < b.to; } );
+
+  m_v_used.assign( nTo, 0 );
+  for( auto& pair : m_v_pairs ){
+    if( m_v_assignment[ pair.from ] >= 0 || m_v_used[ pair.to ] ) continue;
+    m_v_assignment[ pair.from ] = pair.to;
+    m_v_used[ pair.to ] = 1;
+  }
+}
+
+/** @brief Optimal matching
+ *
+ *  Pairs beyond the maximum deltaR cost more than
+ *  any set of real pairs, so the solution first has
+ *  the most real matches, then the smallest sum of deltaR.
+ *  O(n^2 m) with n <= m the collection sizes.
+ *
+ *  @param1 Number of from jets
+ *  @param2 Number of to jets
+ *
+ *  @return void
+ */
+void JetAnalysis :: JetMatcher :: MatchOptimal ( int nFrom, int nTo )
+{
+  // rows are the smaller collection
+  bool transpose = nFrom > nTo;
+  int  n = transpose ? nTo   : nFrom;
+  int  m = transpose ? nFrom : nTo;
+
+  const double noPair = 1 + std::min( n, m ) * ( m_maxDR + 1 );
+  m_v_cost.assign( n * m, noPair );
+  for( auto& pair : m_v_pairs ){
+    int row = transpose ? pair.to   : pair.from;
+    int col = transpose ? pair.from : pair.to;
+    m_v_cost[ row * m + col ] = pair.dR;
+  }
+
+  // potentials, 1-indexed with column 0 as the free slot
+  const double inf = std::numeric_limits<double>::max();
+  m_v_u  .assign( n + 1, 0 );
+  m_v_v  .assign( m + 1, 0 );
+  m_v_p  .assign( m + 1, 0 );
+  m_v_way.assign( m + 1, 0 );
+  for( int i = 1; i <= n; i++ ){
+    m_v_p[0] = i;
+    int j0 = 0;
+    m_v_minv.assign( m + 1, inf );
+    m_v_used.assign( m + 1, 0 );
+    do{
+      m_v_used[j0] = 1;
+      int    i0    = m_v_p[j0];
+      int    j1    = 0;
+      double delta = inf;
+      for( int j = 1; j <= m; j++ ){
+	if( m_v_used[j] ) continue;
+	double cur = m_v_cost[ ( i0 - 1 ) * m + j - 1 ] - m_v_u[i0] - m_v_v[j];
+	if( cur < m_v_minv[j] ){ m_v_minv[j] = cur; m_v_way[j] = j0; }
+	if( m_v_minv[j] < delta ){ delta = m_v_minv[j]; j1 = j; }
+      }
+      for( int j = 0; j <= m; j++ ){
+	if( m_v_used[j] ){ m_v_u[ m_v_p[j] ] += delta; m_v_v[j] -= delta; }
+	else             { m_v_minv[j] -= delta; }
+      }
+      j0 = j1;
+    } while( m_v_p[j0] != 0 );
+    do{
+      int j1 = m_v_way[j0];
+      m_v_p[j0] = m_v_p[j1];
+      j0 = j1;
+    } while( j0 );
+  }
+
+  for( int j = 1; j <= m; j++ ){
+    int i = m_v_p[j];
+    if( !i || m_v_cost[ ( i - 1 ) * m + j - 1 ] >= noPair ) continue;
+    if( transpose ) m_v_assignment[ j - 1 ] = i - 1;
+    else            m_v_assignment[ i - 1 ] = j - 1;
+  }
+}
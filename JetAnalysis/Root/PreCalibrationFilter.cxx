@@ -0,0 +1,189 @@
+/** @file PreCalibrationFilter.cxx
+ *  @brief Implementation of PreCalibrationFilter.
+ *
+ *  PreCalibrationFilter decides from the EM scale pT
+ *  whether a jet can pass the calibrated pT cut, so jets
+ *  that cannot are not copied and calibrated at all.
+ *
+ *  The bound is the largest calibration response 
+ *  (calibrated / EM scale pT) in each |eta| bin, times 
+ *  (1 + margin). It is learned from every jet of the 
+ *  first N events, which are calibrated as usual. After
+ *  that, a jet is skipped if EM pT * bound < cut. Bins
+ *  with no jets during warm up never skip.
+ *
+ *  The bound keeps being checked after warm up: every
+ *  Nth jet that could be skipped is calibrated anyway. If
+ *  it passes the cut it is counted as a violation and the
+ *  bound of its bin is raised, so later jets like it are
+ *  kept. Sampled jets are used as usual, only the jets
+ *  actually skipped can be missing from the output, and
+ *  the violation count says whether that happened.
+ *
+ *  In verification mode no jet is skipped. Each jet the
+ *  filter would have skipped is checked against its
+ *  calibrated pT, and those that pass the cut are counted
+ *  as violations (the bound is then raised).
+ *
+ *  Only the first few violations are printed.
+ *
+ *  @author Yakov Kulinich
+ *  @bug No known bugs.
+ */
+
+#include "JetAnalysis/PreCalibrationFilter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+const unsigned long JetAnalysis :: PreCalibrationFilter :: s_maxViolationPrints = 10;
+
+/** @brief Constructor for PreCalibrationFilter.
+ *
+ *  @param1 Number of warm up events
+ *  @param2 Safety margin on response
+ *  @param3 Verification mode
+ *  @param4 Calibrate every Nth skippable jet (0 = never)
+ */
+JetAnalysis :: PreCalibrationFilter :: PreCalibrationFilter ( int nWarmupEvents,
+							      float margin,
+							      bool verify,
+							      int sampleEvery )
+  : m_nWarmupEvents( nWarmupEvents ),
+    m_margin       ( margin ),
+    m_verify       ( verify ),
+    m_sampleEvery  ( sampleEvery ),
+    m_etaBinWidth  ( 0.1 ),
+    m_v_maxResponse( 50, 0 ),
+    m_nEvents      ( 0 ),
+    m_nJets        ( 0 ),
+    m_nSkipped     ( 0 ),
+    m_nCanSkip     ( 0 ),
+    m_nChecked     ( 0 ),
+    m_nViolations  ( 0 )
+{}
+
+/** @brief Destructor for PreCalibrationFilter.
+ */
+JetAnalysis :: PreCalibrationFilter :: ~PreCalibrationFilter ()
+{}
+
+/** @brief Start of event
+ *
+ *  @return void
+ */
+void JetAnalysis :: PreCalibrationFilter :: StartEvent ()
+{
+  m_nEvents++;
+}
+
+/** @brief Can this jet be skipped
+ *
+ *  @param1 EM scale pT
+ *  @param2 EM scale eta
+ *  @param3 Calibrated pT cut
+ *
+ *  @return true if it cannot pass the cut
+ */
+bool JetAnalysis :: PreCalibrationFilter :: CanSkip ( float emPt, float emEta, float ptCut ) const
+{
+  if( IsWarmingUp() ) return false;
+  float maxResponse = m_v_maxResponse[ EtaBin( emEta ) ];
+  if( maxResponse <= 0 ) return false;
+  return emPt * maxResponse * ( 1 + m_margin ) < ptCut;
+}
+
+/** @brief Should a skippable jet be calibrated anyway
+ *
+ *  Call for each jet CanSkip returned true for.
+ *
+ *  @return true for every Nth call
+ */
+bool JetAnalysis :: PreCalibrationFilter :: Sample ()
+{
+  m_nCanSkip++;
+  return m_sampleEvery > 0 && m_nCanSkip % m_sampleEvery == 0;
+}
+
+/** @brief Count a skipped jet
+ *
+ *  @return void
+ */
+void JetAnalysis :: PreCalibrationFilter :: Skip ()
+{
+  m_nJets++;
+  m_nSkipped++;
+}
+
+/** @brief Check a calibrated jet
+ *
+ *  Learns the response during warm up, in verification
+ *  mode and from sampled jets. Counts violations.
+ *
+ *  @param1 EM scale pT
+ *  @param2 EM scale eta
+ *  @param3 Calibrated pT
+ *  @param4 Calibrated pT cut
+ *  @param5 Would the filter skip it
+ *
+ *  @return void
+ */
+void JetAnalysis :: PreCalibrationFilter :: Check ( float emPt, float emEta, float calibPt,
+						    float ptCut, bool canSkip )
+{
+  m_nJets++;
+  if( canSkip ) m_nChecked++;
+
+  if( canSkip && calibPt >= ptCut ){
+    m_nViolations++;
+    if( m_nViolations <= s_maxViolationPrints ){
+      std::cout << "PreCalibrationFilter : jet with EM pT " << emPt << " eta " << emEta
+		<< " could be skipped but calibrated pT " << calibPt << " passes " << ptCut << std::endl;
+      if( m_nViolations == s_maxViolationPrints )
+	std::cout << "PreCalibrationFilter : further violations are only counted" << std::endl;
+    }
+  }
+
+  if( ( IsWarmingUp() || m_verify || canSkip ) && emPt > 0 ){
+    float& maxResponse = m_v_maxResponse[ EtaBin( emEta ) ];
+    maxResponse = std::max( maxResponse, calibPt / emPt );
+  }
+}
+
+/** @brief Print statistics
+ *
+ *  @param1 Name of caller
+ *
+ *  @return void
+ */
+void JetAnalysis :: PreCalibrationFilter :: Print ( const std::string& caller ) const
+{
+  std::cout << caller << " : PreCalibrationFilter " 
+	    << ( m_verify ? "(verifying) " : "" )
+	    << m_nSkipped << " of " << m_nJets << " jets skipped, "
+	    << m_nChecked << " skippable jets calibrated to check, "
+	    << m_nViolations << " violations" << std::endl;
+  if( m_nViolations && !m_verify )
+    std::cout << caller << " : PreCalibrationFilter bound was too low, "
+	      << "skipped jets may have passed the cut, increase preCalibMargin" << std::endl;
+  for( std::size_t i = 0; i < m_v_maxResponse.size(); i++ ){
+    if( m_v_maxResponse[i] <= 0 ) continue;
+    std::cout << "   |eta| " << i * m_etaBinWidth << " - " << ( i + 1 ) * m_etaBinWidth
+	      << " : max response " << m_v_maxResponse[i] << std::endl;
+  }
+}
+
+/** @brief |eta| bin
+ *
+ *  Last bin includes everything above.
+ *
+ *  @param1 eta
+ *
+ *  @return bin
+ */
+int JetAnalysis :: PreCalibrationFilter :: EtaBin ( float eta ) const
+{
+  int bin = std::abs( eta ) / m_etaBinWidth;
+  return std::min( bin, (int)m_v_maxResponse.size() - 1 );
+}
@@ -0,0 +1,137 @@
+/** @file ResponseHistograms.cxx
+ *  @brief Implementation of ResponseHistograms.
+ *
+ *  ResponseHistograms fills truth - reco response
+ *  matrices and pT response distributions for matched
+ *  MC jets in the event loop, in bins of |eta| and FCalEt,
+ *  one set for nominal and one per JES variation. 
+ *  They are THnSparse, so only bins that are filled 
+ *  take memory, and are written through SharedData.
+ *
+ *  Truth jets without a reco match are filled with a
+ *  negative reco pT, i.e. into the reco pT underflow.
+ *
+ *  Configs (space separated bin edges):
+ *    responsePtBins     - truth and reco pT (GeV)
+ *    responseEtaBins    - truth |eta|
+ *    responseFCalEtBins - FCal sum Et (TeV)
+ *  and
+ *    responseNRatioBins - number of uniform reco / truth
+ *                         pT bins in [0,2] (default 100)
+ *
+ *  @author Yakov Kulinich
+ *  @bug No known bugs.
+ */
+
+#include "JetAnalysis/ResponseHistograms.h"
+
+#include "YKAnalysis/SharedData.h"
+#include "YKAnalysis/HelperFunctions.h"
+
+#include <TEnv.h>
+
+#include <cmath>
+
+/** @brief Constructor for ResponseHistograms.
+ *
+ *  @param1 Number of JES variations (besides nominal)
+ *  @param2 Config
+ */
+JetAnalysis :: ResponseHistograms :: ResponseHistograms ( int nVariations, TEnv* config )
+  : m_isRegistered( false )
+{
+  m_v_ptBins    = vectoriseD( config->GetValue
+			      ( "responsePtBins", 
+				"10 15 20 25 32 40 50 63 79 100 126 158 200 251 316 398 501 631 1000" ) );
+  m_v_ratioBins = makeUniformVec
+    ( config->GetValue( "responseNRatioBins", 100 ), 0, 2 );
+  m_v_etaBins   = vectoriseD( config->GetValue
+			      ( "responseEtaBins", "0 0.3 0.8 1.2 2.1 2.8 3.2 3.6 4.5" ) );
+  m_v_fcalBins  = vectoriseD( config->GetValue
+			      ( "responseFCalEtBins", "-0.1 0.025 0.05 0.1 0.2 0.5 1 2 5" ) );
+
+  for( int v = 0; v <= nVariations; v++ ){
+    std::string suffix = v == 0 ? "nominal" : 
+      Form( "%i_%s", ( v - 1 ) / 2, ( v - 1 ) % 2 ? "down" : "up" );
+    m_v_response  .push_back
+      ( MakeHist( "hResponse_"   + suffix, m_v_ptBins   , "p_{T}^{reco} [GeV]" ) );
+    m_v_ptResponse.push_back
+      ( MakeHist( "hPtResponse_" + suffix, m_v_ratioBins, "p_{T}^{reco}/p_{T}^{truth}" ) );
+  }
+}
+
+/** @brief Destructor for ResponseHistograms.
+ *
+ *  Once registered, SharedData writes them
+ *  and they are left to the output file.
+ */
+JetAnalysis :: ResponseHistograms :: ~ResponseHistograms ()
+{
+  if( m_isRegistered ) return;
+  for( auto& h : m_v_response   ) { delete h; }
+  for( auto& h : m_v_ptResponse ) { delete h; }
+}
+
+/** @brief Register histograms for output
+ *
+ *  @param1 SharedData
+ *
+ *  @return void
+ */
+void JetAnalysis :: ResponseHistograms :: Register ( YKAnalysis::SharedData* sd )
+{
+  for( auto& h : m_v_response   ) { sd->AddOutputObject( h ); }
+  for( auto& h : m_v_ptResponse ) { sd->AddOutputObject( h ); }
+  m_isRegistered = true;
+}
+
+/** @brief Fill one truth jet
+ *
+ *  @param1 Variation
+ *  @param2 Truth pT (GeV)
+ *  @param3 Reco pT (GeV), negative if no match
+ *  @param4 Truth eta
+ *  @param5 FCal sum Et (TeV)
+ *
+ *  @return void
+ */
+void JetAnalysis :: ResponseHistograms :: Fill ( int variation, float ptTruth, float ptReco,
+						 float eta, float fcalEt )
+{
+  double x[4] = { ptTruth, ptReco, std::abs( eta ), fcalEt };
+  m_v_response[ variation ]->Fill( x );
+  if( ptReco < 0 || ptTruth <= 0 ) return;
+  x[1] = ptReco / ptTruth;
+  m_v_ptResponse[ variation ]->Fill( x );
+}
+
+/** @brief Make one histogram
+ *
+ *  @param1 Name
+ *  @param2 Bins of second axis
+ *  @param3 Title of second axis
+ *
+ *  @return new histogram
+ */
+THnSparseF* JetAnalysis :: ResponseHistograms :: MakeHist ( const std::string& name,
+							    const std::vector< double >& yBins,
+							    const std::string& yTitle ) const
+{
+  const std::vector< double >* bins[4] = { &m_v_ptBins, &yBins, &m_v_etaBins, &m_v_fcalBins };
+  const char* titles[4] = { "p_{T}^{truth} [GeV]", yTitle.c_str(), "|#eta|", "#Sigma E_{T}^{FCal} [TeV]" };
+  Int_t    nBins[4];
+  Double_t xMin [4];
+  Double_t xMax [4];
+  for( int d = 0; d < 4; d++ ){
+    nBins[d] = bins[d]->size() - 1;
+    xMin [d] = bins[d]->front();
+    xMax [d] = bins[d]->back();
+  }
+
+  THnSparseF* h = new THnSparseF( name.c_str(), name.c_str(), 4, nBins, xMin, xMax );
+  for( int d = 0; d < 4; d++ ){
+    h->GetAxis(d)->Set( nBins[d], bins[d]->data() );
+    h->GetAxis(d)->SetTitle( titles[d] );
+  }
+  return h;
+}
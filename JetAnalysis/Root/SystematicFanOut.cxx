@@ -0,0 +1,233 @@
+/** @file SystematicFanOut.cxx
+ *  @brief Implementation of SystematicFanOut.
+ *
+ *  SystematicFanOut applies all JES uncertainty components,
+ *  up and down, to jets that were calibrated once. For every
+ *  variation it writes the shifted pT and whether the jet
+ *  passes the pT cut, so the effect of each variation on the
+ *  jetPtMin selection comes out of a single pass.
+ *
+ *  Jets are kept if they pass the cut in any variation, so
+ *  the nominal selection is a mask as well. Everything is
+ *  stored in columns: uncertainties per component, pT and
+ *  masks per variation, and the shifts are applied to whole
+ *  columns after the jet loop.
+ *
+ *  Usage per event:
+ *    Reset( nRecoJets );
+ *    for each calibrated jet :
+ *      float* u = NextJet( pt ); fill u[ i * GetStride() ];
+ *      if( !CanPass() ) Drop();
+ *    Compute();
+ *
+ *  @author Yakov Kulinich
+ *  @bug No known bugs.
+ */
+
+#include "JetAnalysis/SystematicFanOut.h"
+
+#include "YKAnalysis/SharedData.h"
+
+#include <TBranch.h>
+#include <TString.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+/** @brief Constructor for SystematicFanOut.
+ *
+ *  @param1 Number of uncertainty components
+ *  @param2 pT cut (MeV)
+ */
+JetAnalysis :: SystematicFanOut :: SystematicFanOut ( int nComponents, float ptMin )
+  : m_nComponents ( nComponents ),
+    m_ptMin       ( ptMin ),
+    m_nJets       ( 0 ),
+    m_capacity    ( 0 ),
+    m_nCandidates ( 0 ),
+    m_nKept       ( 0 ),
+    m_nPassNominal( 0 )
+{
+  Reserve( 64 );
+}
+
+/** @brief Destructor for SystematicFanOut.
+ */
+JetAnalysis :: SystematicFanOut :: ~SystematicFanOut ()
+{}
+
+/** @brief Add output branches
+ *
+ *  nFanOutJets, fanOutNominalPass, and for each 
+ *  component i: fanOutPt_<i>_up/down, fanOutPass_<i>_up/down
+ *
+ *  @param1 SharedData to add branches to
+ *  @param2 Name of output tree
+ *
+ *  @return void
+ */
+void JetAnalysis :: SystematicFanOut :: AddBranches ( YKAnalysis::SharedData* sd,
+						      const std::string& treeName )
+{
+  sd->AddOutputArrayToTree( "nFanOutJets", &m_nJets, "nFanOutJets/I", treeName );
+  m_v_branches.push_back
+    ( sd->AddOutputArrayToTree( "fanOutNominalPass", m_v_passNominal.data(),
+				"fanOutNominalPass[nFanOutJets]/O", treeName ) );
+  for( int v = 0; v < GetNVariations(); v++ ){
+    std::string suffix = Form( "%i_%s", v / 2, v % 2 ? "down" : "up" );
+    m_v_branches.push_back
+      ( sd->AddOutputArrayToTree( "fanOutPt_" + suffix, &m_v_ptVar[ v * m_capacity ],
+				  "fanOutPt_" + suffix + "[nFanOutJets]/F", treeName ) );
+    m_v_branches.push_back
+      ( sd->AddOutputArrayToTree( "fanOutPass_" + suffix, &m_v_passVar[ v * m_capacity ],
+				  "fanOutPass_" + suffix + "[nFanOutJets]/O", treeName ) );
+  }
+}
+
+/** @brief Start of event
+ *
+ *  @param1 Maximum number of jets this event
+ *
+ *  @return void
+ */
+void JetAnalysis :: SystematicFanOut :: Reset ( std::size_t maxJets )
+{
+  m_nJets = 0;
+  Reserve( maxJets );
+}
+
+/** @brief Add a jet
+ *
+ *  @param1 Calibrated pT (MeV)
+ *
+ *  @return column of this jet, component i at [ i * GetStride() ]
+ */
+float* JetAnalysis :: SystematicFanOut :: NextJet ( float pt )
+{
+  m_nCandidates++;
+  m_v_pt[ m_nJets ] = pt;
+  return &m_v_uncert[ m_nJets++ ];
+}
+
+/** @brief Could the last jet pass the cut in any variation
+ *
+ *  @return true if so
+ */
+bool JetAnalysis :: SystematicFanOut :: CanPass () const
+{
+  const float* u  = &m_v_uncert[ m_nJets - 1 ];
+  float maxShift = 0;
+  for( int i = 0; i < m_nComponents; i++ )
+    { maxShift = std::max( maxShift, std::abs( u[ i * m_capacity ] ) ); }
+  return m_v_pt[ m_nJets - 1 ] * ( 1 + maxShift ) >= m_ptMin;
+}
+
+/** @brief Remove last jet
+ *
+ *  @return void
+ */
+void JetAnalysis :: SystematicFanOut :: Drop ()
+{
+  m_nJets--;
+}
+
+/** @brief Copy uncertainties of last jet
+ *
+ *  @param1 Output array
+ *  @param2 Stride between components in output
+ *
+ *  @return void
+ */
+void JetAnalysis :: SystematicFanOut :: CopyLastJet ( float* out, std::size_t stride ) const
+{
+  const float* u = &m_v_uncert[ m_nJets - 1 ];
+  for( int i = 0; i < m_nComponents; i++ )
+    { out[ i * stride ] = u[ i * m_capacity ]; }
+}
+
+/** @brief Apply all variations
+ *
+ *  One pass over contiguous columns per variation.
+ *
+ *  @return void
+ */
+void JetAnalysis :: SystematicFanOut :: Compute ()
+{
+  const int    n     = m_nJets;
+  const float  ptMin = m_ptMin;
+  const float* pt    = m_v_pt.data();
+
+  UChar_t* passNominal = m_v_passNominal.data();
+  for( int j = 0; j < n; j++ ){ passNominal[j] = pt[j] >= ptMin; }
+
+  for( int i = 0; i < m_nComponents; i++ ){
+    const float* u = &m_v_uncert[ i * m_capacity ];
+    float*   ptUp     = &m_v_ptVar  [ ( 2 * i     ) * m_capacity ];
+    float*   ptDown   = &m_v_ptVar  [ ( 2 * i + 1 ) * m_capacity ];
+    UChar_t* passUp   = &m_v_passVar[ ( 2 * i     ) * m_capacity ];
+    UChar_t* passDown = &m_v_passVar[ ( 2 * i + 1 ) * m_capacity ];
+    for( int j = 0; j < n; j++ ){
+      ptUp  [j] = pt[j] * ( 1 + u[j] );
+      ptDown[j] = pt[j] * ( 1 - u[j] );
+    }
+    for( int j = 0; j < n; j++ ){
+      passUp  [j] = ptUp  [j] >= ptMin;
+      passDown[j] = ptDown[j] >= ptMin;
+    }
+  }
+
+  m_nKept += n;
+  for( int j = 0; j < n; j++ ){ m_nPassNominal += passNominal[j]; }
+}
+
+/** @brief Grow buffers
+ *
+ *  Grows only. Branch addresses follow the buffers.
+ *
+ *  @param1 Number of jets
+ *
+ *  @return void
+ */
+void JetAnalysis :: SystematicFanOut :: Reserve ( std::size_t nJets )
+{
+  if( nJets <= m_capacity ) return;
+  m_capacity = std::max( nJets, 2 * m_capacity );
+
+  m_v_uncert     .assign( m_nComponents * m_capacity, 0 );
+  m_v_pt         .assign( m_capacity, 0 );
+  m_v_passNominal.assign( m_capacity, 0 );
+  m_v_ptVar      .assign( GetNVariations() * m_capacity, 0 );
+  m_v_passVar    .assign( GetNVariations() * m_capacity, 0 );
+
+  SetAddress();
+}
+
+/** @brief Point branches at the buffers
+ *
+ *  @return void
+ */
+void JetAnalysis :: SystematicFanOut :: SetAddress ()
+{
+  if( m_v_branches.empty() ) return;
+  m_v_branches[0]->SetAddress( m_v_passNominal.data() );
+  for( int v = 0; v < GetNVariations(); v++ ){
+    m_v_branches[ 1 + 2 * v     ]->SetAddress( &m_v_ptVar  [ v * m_capacity ] );
+    m_v_branches[ 1 + 2 * v + 1 ]->SetAddress( &m_v_passVar[ v * m_capacity ] );
+  }
+}
+
+/** @brief Print statistics
+ *
+ *  @param1 Name of caller
+ *
+ *  @return void
+ */
+void JetAnalysis :: SystematicFanOut :: Print ( const std::string& caller ) const
+{
+  std::cout << caller << " : SystematicFanOut "
+	    << GetNVariations() << " variations, "
+	    << m_nCandidates  << " candidate jets, "
+	    << m_nKept        << " kept, "
+	    << m_nPassNominal << " pass nominal" << std::endl;
+}
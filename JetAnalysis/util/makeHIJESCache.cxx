@@ -0,0 +1,69 @@
+/** @file makeHIJESCache.cxx
+ *  @brief Write binary cache for HIJESUncertaintyProvider
+ *
+ *  Reads the HI JES uncertainty graphs and cross
+ *  calibration histograms from the ROOT files in
+ *  JetAnalysis/data, builds the lookup tables and
+ *  writes them next to the ROOT file with a .bin
+ *  extension. The provider maps that file at startup
+ *  unless the size or mtime of either ROOT input has
+ *  changed since it was written (then the ROOT files
+ *  are read and the cache must be rebuilt), or its
+ *  table deviation is above hiJESTableTolerance.
+ *
+ *  Usage: makeHIJESCache [HIJESUncert_data15_5TeV.root]
+ *
+ *  @author Yakov Kulinich
+ *  @bug No known bugs.
+ */
+
+#include "JetAnalysis/HIJESUncertaintyProvider.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cmath>
+
+int main( int argc, char* argv[] ){
+
+  std::string fileName = "HIJESUncert_data15_5TeV.root";
+  if( argc == 2 ){ fileName = argv[1]; }
+
+  std::string cacheName = fileName.substr( 0, fileName.rfind(".root") ) + ".bin";
+  std::string cachePath = HIJESUncertaintyProvider::DataPath( cacheName );
+
+  // build from ROOT files, not from an existing cache
+  HIJESUncertaintyProvider provider( fileName, 1e-5, false );
+
+  if( !provider.WriteCache( cachePath, fileName ) ){
+    std::cerr << "makeHIJESCache : Could not write " << cachePath << std::endl;
+    return 1;
+  }
+
+  // read it back and compare
+  HIJESUncertaintyProvider cached( fileName );
+  if( !cached.UsingCache() ){
+    std::cerr << "makeHIJESCache : Could not read back " << cachePath << std::endl;
+    return 1;
+  }
+
+  std::vector< std::string > components;
+  provider.GetUncertaintyComponentKeys( components );
+  float maxDiff = 0;
+  for( unsigned int c = 0; c < components.size(); c++ ){
+    int handle = cached.GetComponentHandle( components[c] );
+    for( float eta = -4.5; eta <= 4.5; eta += 0.05 ){
+      for( float pt = 10; pt < 2000; pt *= 1.05 ){
+	float diff = provider.GetUncertaintyComponent( (int)c, pt, eta ) -
+	  cached.GetUncertaintyComponent( handle, pt, eta );
+	if( std::abs( diff ) > maxDiff ){ maxDiff = std::abs( diff ); }
+      }
+    }
+  }
+  
+  std::cout << "makeHIJESCache : Wrote " << cachePath 
+	    << ", " << components.size() << " components, max difference " 
+	    << maxDiff << std::endl;
+
+  return maxDiff == 0 ? 0 : 1;
+}
@@ -88,12 +88,12 @@ xAOD::TReturnCode OverlayAnalysis :: OverlayAnalysis :: HistInitialize ()
 {
   std::cout << m_analysisName << " HistInitialize" << std::endl;
 
-  m_sd->AddOutputToTree<int> ( "eventNumber" , &m_eventNumber  );
-  m_sd->AddOutputToTree<int> ( "LBN"         , &m_LBN          );
-  m_sd->AddOutputToTree<int> ( "runNumber"   , &m_runNumber    );
-  m_sd->AddOutputToTree<bool>( "haveDaqError", &m_haveDaqError );
+  m_sd->AddOutputToTree<int> ( "eventNumber" , &m_eventNumber , m_outputTreeName );
+  m_sd->AddOutputToTree<int> ( "LBN"         , &m_LBN         , m_outputTreeName );
+  m_sd->AddOutputToTree<int> ( "runNumber"   , &m_runNumber   , m_outputTreeName );
+  m_sd->AddOutputToTree<bool>( "haveDaqError", &m_haveDaqError, m_outputTreeName );
 
-  m_sd->AddOutputToTree< std::vector<TVector3> >( "vertices", &m_vertices );
+  m_sd->AddOutputToTree< std::vector<TVector3> >( "vertices", &m_vertices, m_outputTreeName );
 
   TEnv* config = m_sd->GetConfig();
 
@@ -103,8 +103,8 @@ xAOD::TReturnCode OverlayAnalysis :: OverlayAnalysis :: HistInitialize ()
     std::cout << "Trigger Menu: " << m_triggerMenu << std::endl; 
     for( auto& tr : m_v_triggers ){
       std::cout << "setting: " << tr << std::endl;
-      m_sd->AddOutputToTree<bool> ( Form("passed_%s", tr.c_str()), &m_m_passed_triggers[tr] );
-      m_sd->AddOutputToTree<float>( Form("prescale_%s", tr.c_str()), &m_m_prescale_triggers[tr] );
+      m_sd->AddOutputToTree<bool> ( Form("passed_%s", tr.c_str()), &m_m_passed_triggers[tr], m_outputTreeName );
+      m_sd->AddOutputToTree<float>( Form("prescale_%s", tr.c_str()), &m_m_prescale_triggers[tr], m_outputTreeName );
     }
   }
 
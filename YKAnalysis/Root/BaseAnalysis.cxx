@@ -13,15 +13,17 @@
  */
 
 #include "YKAnalysis/BaseAnalysis.h"
+#include "YKAnalysis/GoodRunsCache.h"
+#include "YKAnalysis/EventShape.h"
 
 #include <xAODTracking/VertexContainer.h>
 #include <xAODTruth/TruthVertexContainer.h>
-#include <xAODHIEvent/HIEventShapeContainer.h>
 
 #include <TSystem.h>
 
 #include <fstream>
 #include <sstream>
+#include <algorithm>
 
 /** @brief Default Constructor for BaseAnalysis.
  */
@@ -97,12 +99,12 @@ xAOD::TReturnCode YKAnalysis :: BaseAnalysis :: HistInitialize ()
 {
   std::cout << m_analysisName << " HistInitialize" << std::endl;
 
-  m_sd->AddOutputToTree<int>( "eventNumber", &m_eventNumber );
-  m_sd->AddOutputToTree<int>( "LBN", &m_LBN );
-  m_sd->AddOutputToTree<int>( "runNumber", &m_runNumber );
+  m_sd->AddOutputToTree<int>( "eventNumber", &m_eventNumber, m_outputTreeName );
+  m_sd->AddOutputToTree<int>( "LBN", &m_LBN, m_outputTreeName );
+  m_sd->AddOutputToTree<int>( "runNumber", &m_runNumber, m_outputTreeName );
 
-  m_sd->AddOutputToTree< double >( "FCalEtA", &m_FCalEtA );
-  m_sd->AddOutputToTree< double >( "FCalEtC", &m_FCalEtC );
+  m_sd->AddOutputToTree< double >( "FCalEtA", &m_FCalEtA, m_outputTreeName );
+  m_sd->AddOutputToTree< double >( "FCalEtC", &m_FCalEtC, m_outputTreeName );
 
   TEnv* config = m_sd->GetConfig();
 
@@ -112,8 +114,8 @@ xAOD::TReturnCode YKAnalysis :: BaseAnalysis :: HistInitialize ()
     std::cout << "Trigger Menu: " << m_triggerMenu << std::endl; 
     for( auto& tr : m_v_triggers ){
       std::cout << "setting: " << tr << std::endl;
-      m_sd->AddOutputToTree<bool> ( Form("passed_%s", tr.c_str()), &m_m_passed_triggers[tr] );
-      m_sd->AddOutputToTree<float>( Form("prescale_%s", tr.c_str()), &m_m_prescale_triggers[tr] );
+      m_sd->AddOutputToTree<bool> ( Form("passed_%s", tr.c_str()), &m_m_passed_triggers[tr], m_outputTreeName );
+      m_sd->AddOutputToTree<float>( Form("prescale_%s", tr.c_str()), &m_m_prescale_triggers[tr], m_outputTreeName );
     }
   }
 
@@ -137,32 +139,25 @@ xAOD::TReturnCode YKAnalysis :: BaseAnalysis :: Initialize ()
  
   bool isData = config->GetValue( "isData", false );
 
+  TStopwatch sw;
+  sw.Start();
+
   //--------------------------------
   //    GRL - Good Runs List
   //--------------------------------
   if( isData ){
-    m_grl = new GoodRunsListSelectionTool("GoodRunsListSelectionTool");
-    std::string GRLDirPath = "$ROOTCOREBIN/../YKAnalysis/share/";
-  
-    char comT[256];
-    sprintf(comT,"ls %s*.xml", GRLDirPath.c_str() );
-    FILE* pipe = gSystem->OpenPipe(comT,"r");
+    std::vector<std::string> vecStringGRL = GetGRLFiles();
+    std::string grlCacheFile = config->GetValue( "grlCacheFile", "grlCache.bin" );
 
-    TString fullGRLPath;
-    std::vector<std::string> vecStringGRL;
-  
     std::cout << "Using following GRL's:" << std::endl;
-    while( fullGRLPath.Gets(pipe) ){
-      std::cout << fullGRLPath.Data() << std::endl;
-      vecStringGRL.push_back( fullGRLPath.Data() );
-    }
+    for( auto& grl : vecStringGRL ) std::cout << grl << std::endl;
 
-    CHECK_STATUS( Form("%s::execute",m_analysisName.c_str() ), 
-		  m_grl->setProperty( "GoodRunsListVec", vecStringGRL) );
-    CHECK_STATUS( Form("%s::execute",m_analysisName.c_str() ), 
-		  m_grl->setProperty( "PassThrough", false) );  // Don't ignore GRL result
-    CHECK_STATUS( Form("%s::execute",m_analysisName.c_str() ), 
-		  m_grl->initialize() );
+    m_grl = new GoodRunsCache();
+    if( !m_grl->Initialize( vecStringGRL, grlCacheFile ) ){
+      Error( Form("%s::initialize",m_analysisName.c_str() ), "Could not load GRL" );
+      return xAOD::TReturnCode::kFailure;
+    }
+    printInitTime( m_analysisName, "GoodRunsCache", sw );
   }
 
   //--------------------------------
@@ -173,6 +168,7 @@ xAOD::TReturnCode YKAnalysis :: BaseAnalysis :: Initialize ()
     m_trigConfigTool = new TrigConf::xAODConfigTool("xAODConfigTool"); // gives us access to the meta-data
     CHECK_STATUS( Form("%s::execute",m_analysisName.c_str() ),
 		  m_trigConfigTool->initialize() );
+    printInitTime( m_analysisName, "xAODConfigTool", sw );
     
     ToolHandle< TrigConf::ITrigConfigTool > trigConfigHandle( m_trigConfigTool );
     m_trigDecisionTool = new Trig::TrigDecisionTool( "TrigDecisionTool" );
@@ -182,6 +178,7 @@ xAOD::TReturnCode YKAnalysis :: BaseAnalysis :: Initialize ()
 		  m_trigDecisionTool->setProperty( "TrigDecisionKey", "xTrigDecision" ) );
     CHECK_STATUS( Form("%s::execute",m_analysisName.c_str() ), 
 		  m_trigDecisionTool->initialize() );
+    printInitTime( m_analysisName, "TrigDecisionTool", sw );
   }
 
   //--------------------------------
@@ -195,6 +192,42 @@ xAOD::TReturnCode YKAnalysis :: BaseAnalysis :: Initialize ()
   return xAOD::TReturnCode::kSuccess;
 }
 
+/** @brief Get list of GRL xml files.
+ *
+ *  Taken from grlFiles in the config. Names without
+ *  a directory are looked for in YKAnalysis/share.
+ *  If grlFiles is not given, every xml in 
+ *  YKAnalysis/share is used.
+ *
+ *  @return vector of xml files
+ */
+std::vector< std::string > YKAnalysis :: BaseAnalysis :: GetGRLFiles()
+{
+  TEnv* config = m_sd->GetConfig();
+
+  TString GRLDirPath = "$ROOTCOREBIN/../YKAnalysis/share/";
+  gSystem->ExpandPathName( GRLDirPath );
+
+  std::vector< std::string > vecStringGRL = 
+    vectorise( config->GetValue( "grlFiles", "" ) );
+
+  if( vecStringGRL.empty() ){
+    void* dir = gSystem->OpenDirectory( GRLDirPath );
+    while( const char* entry = gSystem->GetDirEntry( dir ) ){
+      if( TString( entry ).EndsWith( ".xml" ) )
+	vecStringGRL.push_back( entry );
+    }
+    gSystem->FreeDirectory( dir );
+    std::sort( vecStringGRL.begin(), vecStringGRL.end() );
+  }
+
+  for( auto& grl : vecStringGRL ){
+    if( grl.find( '/' ) == std::string::npos ) grl = GRLDirPath.Data() + grl;
+  }
+
+  return vecStringGRL;
+}
+
 /** @brief Event Loop method for BaseAnalysis.
  *
  *  @return xAOD::TReturnCode::kSuccess if
@@ -242,7 +275,7 @@ xAOD::TReturnCode YKAnalysis :: BaseAnalysis :: ProcessEvent(){
   //---------------------
   // if data check if event passes GRL
   if( !isMC ){ // it's data!
-    if( !m_grl->passRunLB(*eventInfo) ){ 
+    if( !m_grl->PassRunLB( m_runNumber, m_LBN ) ){ 
       m_sd->GetEventStatistics()->Fill( "GRL Reject", 1 );  // grl reject
       return xAOD::TReturnCode::kRecoverable; // goto next event
     } 
@@ -319,23 +352,12 @@ xAOD::TReturnCode YKAnalysis :: BaseAnalysis :: ProcessEvent(){
   //---------------------
   // FCal
   //---------------------
-  const xAOD::HIEventShapeContainer* calos=0;
-  CHECK_STATUS( "execute:", eventStore->retrieve( calos, "CaloSums"));
-
-  float m_fcalEt = 0;
-  m_FCalEtA = 0;
-  m_FCalEtC = 0;
-  const xAOD::HIEventShapeContainer *ptrEvtShpCon = 0;
-  CHECK_STATUS( "execute:", eventStore->retrieve(ptrEvtShpCon,"HIEventShape"));
-  for(const auto* ptrEvtShp : *ptrEvtShpCon){
-    if(ptrEvtShp->layer()!=21 && ptrEvtShp->layer()!=22 &&
-       ptrEvtShp->layer()!=23) continue;
-    m_fcalEt += ptrEvtShp->et()/1E6;
-    if((ptrEvtShp->etaMin()+ptrEvtShp->etaMax())/2>0) m_FCalEtA +=
-							ptrEvtShp->et()/1E6;
-    if((ptrEvtShp->etaMin()+ptrEvtShp->etaMax())/2<0) m_FCalEtC +=
-							ptrEvtShp->et()/1E6;
-  }
+  // layers 21-23, retrieved once per event for all analyses
+  EventShape* eventShape = m_sd->GetEventShape();
+  CHECK_STATUS( "execute:", eventShape->Retrieve( eventStore ) );
+
+  m_FCalEtA = eventShape->GetFCalEt( EventShape::kA ) / 1E6;
+  m_FCalEtC = eventShape->GetFCalEt( EventShape::kC ) / 1E6;
 
 
   return xAOD::TReturnCode::kSuccess;
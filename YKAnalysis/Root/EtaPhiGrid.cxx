@@ -0,0 +1,243 @@
+/** @file EtaPhiGrid.cxx
+ *  @brief Implementation of EtaPhiGrid.
+ *
+ *  EtaPhiGrid is a per event spatial index of
+ *  objects (tracks, jets, ...) in eta-phi. Objects are
+ *  counting-sorted into cells roughly the size of the
+ *  cone being searched, so a cone query only visits the
+ *  few cells around it instead of every object.
+ *  Phi wraps around. Objects beyond the eta range
+ *  go into the edge cells, so none are lost.
+ *
+ *  The storage is kept between events, so after the
+ *  first few events Build does not allocate.
+ *
+ *  @author Yakov Kulinich
+ *  @bug No known bugs.
+ */
+
+#include "YKAnalysis/EtaPhiGrid.h"
+#include "YKAnalysis/Kinematics.h"
+
+#include <algorithm>
+#include <cmath>
+
+static const double s_pi    = 3.14159265358979323846;
+static const double s_twoPi = 2 * s_pi;
+
+/** @brief Default Constructor for EtaPhiGrid.
+ *
+ *  |eta| < 2.5 in cells of 0.4
+ */
+YKAnalysis :: EtaPhiGrid :: EtaPhiGrid ()
+  : EtaPhiGrid( 2.5, 0.4 )
+{}
+
+/** @brief Constructor for EtaPhiGrid.
+ *
+ *  @param1 Max |eta| of grid
+ *  @param2 Approximate cell size in eta and phi
+ */
+YKAnalysis :: EtaPhiGrid :: EtaPhiGrid ( double etaMax, double cellSize )
+  : m_etaMax ( etaMax ),
+    m_useSIMD( true )
+{
+  m_nEtaCells   = std::max( 1, int( std::ceil( 2 * etaMax / cellSize ) ) );
+  m_nPhiCells   = std::max( 1, int( s_twoPi / cellSize ) );
+  m_etaCellSize = 2 * etaMax / m_nEtaCells;
+  m_phiCellSize = s_twoPi / m_nPhiCells;
+
+  m_cellStart.assign( m_nEtaCells * m_nPhiCells + 1, 0 );
+}
+
+/** @brief Destructor for EtaPhiGrid.
+ */
+YKAnalysis :: EtaPhiGrid :: ~EtaPhiGrid ()
+{}
+
+/** @brief Clear grid
+ *
+ *  Keeps capacity.
+ *
+ *  @return void
+ */
+void YKAnalysis :: EtaPhiGrid :: Clear ()
+{
+  std::fill( m_cellStart.begin(), m_cellStart.end(), 0 );
+  m_cell .clear();
+  m_index.clear();
+  m_eta  .clear();
+  m_phi  .clear();
+  m_value.clear();
+}
+
+/** @brief Fill grid with objects
+ *
+ *  @param1 eta of objects
+ *  @param2 phi of objects
+ *  @param3 value to sum for objects (e.g. pT), can be NULL
+ *  @param4 number of objects
+ *
+ *  @return void
+ */
+void YKAnalysis :: EtaPhiGrid :: Build ( const float* eta, const float* phi,
+					 const float* value, std::size_t n )
+{
+  Clear();
+
+  m_cell .resize( n );
+  m_index.resize( n );
+  m_eta  .resize( n );
+  m_phi  .resize( n );
+  m_value.resize( n );
+  m_dR2  .resize( n );
+
+  // count objects per cell
+  for( std::size_t i = 0; i < n; i++ ){
+    int cell  = EtaCell( eta[i] ) * m_nPhiCells + PhiCell( phi[i] );
+    m_cell[i] = cell;
+    m_cellStart[ cell + 1 ]++;
+  }
+
+  for( std::size_t c = 1; c < m_cellStart.size(); c++ )
+    m_cellStart[c] += m_cellStart[c-1];
+
+  // place them, cellStart is used as cursor then restored
+  for( std::size_t i = 0; i < n; i++ ){
+    int pos = m_cellStart[ m_cell[i] ]++;
+    m_index[pos] = i;
+    m_eta  [pos] = eta[i];
+    m_phi  [pos] = phi[i];
+    m_value[pos] = value ? value[i] : 1;
+  }
+
+  for( std::size_t c = m_cellStart.size() - 1; c > 0; c-- )
+    m_cellStart[c] = m_cellStart[c-1];
+  m_cellStart[0] = 0;
+}
+
+/** @brief Get objects within radius
+ *
+ *  Indices refer to input arrays of Build.
+ *  Order is by cell, not by distance.
+ *
+ *  @param1 eta of cone axis
+ *  @param2 phi of cone axis
+ *  @param3 radius (deltaR <= R passes)
+ *  @param4 output vector of indices (cleared)
+ *
+ *  @return void
+ */
+void YKAnalysis :: EtaPhiGrid :: GetNear ( float eta, float phi, float R,
+					   std::vector< int >& v_index )
+{
+  v_index.clear();
+
+  int etaLow, etaHigh, phiLow, nPhi;
+  CellRange( eta, phi, R, etaLow, etaHigh, phiLow, nPhi );
+
+  float R2 = R * R;
+  for( int ie = etaLow; ie <= etaHigh; ie++ ){
+    for( int k = 0; k < nPhi; k++ ){
+      int cell  = ie * m_nPhiCells + ( phiLow + k ) % m_nPhiCells;
+      int start = m_cellStart[cell];
+      int n     = m_cellStart[cell+1] - start;
+      if( !n ) continue;
+      Kinematics::DeltaR2Batch( eta, phi, &m_eta[start], &m_phi[start], n, &m_dR2[0], m_useSIMD );
+      for( int i = 0; i < n; i++ ){
+	if( m_dR2[i] <= R2 ) v_index.push_back( m_index[start+i] );
+      }
+    }
+  }
+}
+
+/** @brief Sum values in cones
+ *
+ *  Sums values of objects within each radius
+ *  and with value above each threshold, in one
+ *  pass over nearby cells.
+ *
+ *  @param1 eta of cone axis
+ *  @param2 phi of cone axis
+ *  @param3 radii (deltaR <= R passes)
+ *  @param4 thresholds (value > threshold passes)
+ *  @param5 output sums, [ iR * nThresholds + iThreshold ]
+ *
+ *  @return void
+ */
+void YKAnalysis :: EtaPhiGrid :: SumInCones ( float eta, float phi,
+					      const std::vector< float >& v_R,
+					      const std::vector< float >& v_thresholds,
+					      std::vector< double >& v_sums )
+{
+  std::size_t nR = v_R.size();
+  std::size_t nT = v_thresholds.size();
+  v_sums.assign( nR * nT, 0 );
+  if( !nR ) return;
+
+  float Rmax = *std::max_element( v_R.begin(), v_R.end() );
+
+  int etaLow, etaHigh, phiLow, nPhi;
+  CellRange( eta, phi, Rmax, etaLow, etaHigh, phiLow, nPhi );
+
+  for( int ie = etaLow; ie <= etaHigh; ie++ ){
+    for( int k = 0; k < nPhi; k++ ){
+      int cell  = ie * m_nPhiCells + ( phiLow + k ) % m_nPhiCells;
+      int start = m_cellStart[cell];
+      int n     = m_cellStart[cell+1] - start;
+      if( !n ) continue;
+      Kinematics::DeltaR2Batch( eta, phi, &m_eta[start], &m_phi[start], n, &m_dR2[0], m_useSIMD );
+      for( int i = 0; i < n; i++ ){
+	float dR2  = m_dR2[i];
+	float val  = m_value[start+i];
+	for( std::size_t iR = 0; iR < nR; iR++ ){
+	  if( dR2 > v_R[iR] * v_R[iR] ) continue;
+	  for( std::size_t iT = 0; iT < nT; iT++ ){
+	    if( val > v_thresholds[iT] ) v_sums[ iR * nT + iT ] += val;
+	  }
+	}
+      }
+    }
+  }
+}
+
+/** @brief Range of cells to visit for a cone
+ *
+ *  @param1 eta of cone axis
+ *  @param2 phi of cone axis
+ *  @param3 radius
+ *  @param4 first eta cell
+ *  @param5 last eta cell
+ *  @param6 first phi cell
+ *  @param7 number of phi cells (wrapping)
+ *
+ *  @return void
+ */
+void YKAnalysis :: EtaPhiGrid :: CellRange ( float eta, float phi, float R,
+					     int& etaLow, int& etaHigh,
+					     int& phiLow, int& nPhi ) const
+{
+  etaLow  = EtaCell( eta - R );
+  etaHigh = EtaCell( eta + R );
+
+  int span = int( std::ceil( R / m_phiCellSize ) );
+  if( 2 * span + 1 >= m_nPhiCells ){
+    phiLow = 0;
+    nPhi   = m_nPhiCells;
+  } else {
+    phiLow = ( PhiCell( phi ) - span + m_nPhiCells ) % m_nPhiCells;
+    nPhi   = 2 * span + 1;
+  }
+}
+
+int YKAnalysis :: EtaPhiGrid :: EtaCell ( float eta ) const
+{
+  int cell = int( std::floor( ( eta + m_etaMax ) / m_etaCellSize ) );
+  return std::min( std::max( cell, 0 ), m_nEtaCells - 1 );
+}
+
+int YKAnalysis :: EtaPhiGrid :: PhiCell ( float phi ) const
+{
+  int cell = int( std::floor( ( phi + s_pi ) / m_phiCellSize ) ) % m_nPhiCells;
+  return cell < 0 ? cell + m_nPhiCells : cell;
+}
@@ -0,0 +1,120 @@
+/** @file EventShape.cxx
+ *  @brief Implementation of EventShape.
+ *
+ *  EventShape holds the per-layer, per-side Et sums
+ *  and Et-weighted cos/sin moments of the HIEventShape
+ *  container for the current event. It is filled once
+ *  per event by the first analysis that asks for it,
+ *  SharedData clears it at the end of every event.
+ *
+ *  HIEventShape has one entry per calorimeter layer
+ *  (CaloSampling) and eta slice. An entry is on side A
+ *  if the center of its slice is at eta > 0, on side C
+ *  if it is at eta < 0.
+ *
+ *  FCal Et is the sum over layers 21-23 (FCal0-2),
+ *  both sides, i.e. 3.2 < |eta| < 4.9.
+ *
+ *  @author Yakov Kulinich
+ *  @bug No known bugs.
+ */
+
+#include "YKAnalysis/EventShape.h"
+
+#include <xAODHIEvent/HIEventShapeContainer.h>
+
+#include <algorithm>
+
+/** @brief Default Constructor for EventShape.
+ */
+YKAnalysis :: EventShape :: EventShape ()
+  : EventShape( "HIEventShape" )
+{}
+
+/** @brief Constructor for EventShape.
+ *
+ *  @param1 Name of event shape container
+ */
+YKAnalysis :: EventShape :: EventShape ( const std::string& containerName )
+  : m_containerName( containerName ),
+    m_isFilled     ( false )
+{
+  Zero();
+}
+
+/** @brief Destructor for EventShape.
+ */
+YKAnalysis :: EventShape :: ~EventShape ()
+{}
+
+/** @brief Zero all sums
+ *
+ *  @return void
+ */
+void YKAnalysis :: EventShape :: Zero ()
+{
+  std::fill( &m_et       [0][0]   , &m_et       [0][0]    + kNLayers * 2, 0. );
+  std::fill( &m_etCos    [0][0][0], &m_etCos    [0][0][0] + kNLayers * 2 * kNHarmonics, 0. );
+  std::fill( &m_etSin    [0][0][0], &m_etSin    [0][0][0] + kNLayers * 2 * kNHarmonics, 0. );
+  std::fill( &m_fcalEt   [0]      , &m_fcalEt   [0]       + 2, 0. );
+  std::fill( &m_fcalEtCos[0][0]   , &m_fcalEtCos[0][0]    + 2 * kNHarmonics, 0. );
+  std::fill( &m_fcalEtSin[0][0]   , &m_fcalEtSin[0][0]    + 2 * kNHarmonics, 0. );
+}
+
+/** @brief Fill sums for this event
+ *
+ *  Does nothing if already filled this event.
+ *
+ *  @param1 Event store
+ *
+ *  @return xAOD::TReturnCode
+ */
+xAOD::TReturnCode YKAnalysis :: EventShape :: Retrieve ( xAOD::TEvent* eventStore )
+{
+  if( m_isFilled ) return xAOD::TReturnCode::kSuccess;
+
+  const xAOD::HIEventShapeContainer* eventShapes = 0;
+  if( !eventStore->retrieve( eventShapes, m_containerName ).isSuccess() )
+    return xAOD::TReturnCode::kFailure;
+
+  for( const auto* eventShape : *eventShapes ){
+    int layer = eventShape->layer();
+    if( layer < 0 || layer >= kNLayers ) continue;
+
+    float etaCenter = ( eventShape->etaMin() + eventShape->etaMax() ) / 2;
+    if( etaCenter == 0 ) continue;
+    int side = etaCenter > 0 ? kA : kC;
+
+    m_et[ layer ][ side ] += eventShape->et();
+
+    const std::vector< float >& etCos = eventShape->etCos();
+    const std::vector< float >& etSin = eventShape->etSin();
+    int nCos = std::min( int( etCos.size() ), int( kNHarmonics ) );
+    int nSin = std::min( int( etSin.size() ), int( kNHarmonics ) );
+    for( int k = 0; k < nCos; k++ ) m_etCos[ layer ][ side ][k] += etCos[k];
+    for( int k = 0; k < nSin; k++ ) m_etSin[ layer ][ side ][k] += etSin[k];
+  }
+
+  for( int layer = kFCalFirstLayer; layer <= kFCalLastLayer; layer++ ){
+    for( int side = kC; side <= kA; side++ ){
+      m_fcalEt[ side ] += m_et[ layer ][ side ];
+      for( int k = 0; k < kNHarmonics; k++ ){
+	m_fcalEtCos[ side ][k] += m_etCos[ layer ][ side ][k];
+	m_fcalEtSin[ side ][k] += m_etSin[ layer ][ side ][k];
+      }
+    }
+  }
+
+  m_isFilled = true;
+  return xAOD::TReturnCode::kSuccess;
+}
+
+/** @brief Clear sums
+ *
+ *  @return void
+ */
+void YKAnalysis :: EventShape :: Clear ()
+{
+  if( m_isFilled ) Zero();
+  m_isFilled = false;
+}
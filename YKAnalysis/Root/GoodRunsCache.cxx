@@ -0,0 +1,260 @@
+/** @file GoodRunsCache.cxx
+ *  @brief Implementation of GoodRunsCache.
+ *
+ *  GoodRunsCache holds the good run / lumi block
+ *  intervals from a set of GRL xml files as a flat bitmap,
+ *  one bit per lumi block, so the per event check is O(1).
+ *
+ *  Parsing the xml is slow, so the intervals are written
+ *  to a small binary cache file. The cache remembers the path,
+ *  size and modification time of each xml it was built from
+ *  and is only rebuilt when one of those changes.
+ *
+ *  @author Yakov Kulinich
+ *  @bug No known bugs.
+ */
+
+#include "YKAnalysis/GoodRunsCache.h"
+
+#include <GoodRunsLists/TGoodRunsListReader.h>
+#include <GoodRunsLists/TGoodRunsList.h>
+
+#include <TSystem.h>
+#include <TString.h>
+
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <cstring>
+
+const char     YKAnalysis :: GoodRunsCache :: s_magic[8] = { 'Y','K','G','R','L','C','\0','\0' };
+const uint32_t YKAnalysis :: GoodRunsCache :: s_version  = 1;
+const int32_t  YKAnalysis :: GoodRunsCache :: s_maxLB    = 1 << 20;
+
+/** @brief Default Constructor for GoodRunsCache.
+ */
+YKAnalysis :: GoodRunsCache :: GoodRunsCache ()
+  : m_lastRun  ( -1 ),
+    m_lastEntry( RunEntry{ 0, 0, INT32_MAX } )
+{}
+
+/** @brief Destructor for GoodRunsCache.
+ */
+YKAnalysis :: GoodRunsCache :: ~GoodRunsCache ()
+{}
+
+/** @brief Initialize the cache.
+ *
+ *  Uses the binary cache if it was built from the
+ *  same xml files, otherwise parses the xml files and
+ *  rewrites the cache.
+ *
+ *  @param1 vector of GRL xml files
+ *  @param2 name of binary cache file
+ *
+ *  @return true if successful
+ */
+bool YKAnalysis :: GoodRunsCache :: Initialize( const std::vector< std::string >& xmlFiles,
+						const std::string& cacheFile )
+{
+  if( !ReadSources( xmlFiles ) ) return false;
+
+  if( ReadCache( cacheFile ) ){
+    std::cout << "GoodRunsCache : Using cache " << cacheFile << std::endl;
+  } else {
+    std::cout << "GoodRunsCache : Building cache " << cacheFile << std::endl;
+    if( !ReadXML() ) return false;
+    if( !WriteCache( cacheFile ) ){
+      std::cerr << "GoodRunsCache : Could not write " << cacheFile
+		<< ", continuing without it" << std::endl;
+    }
+  }
+
+  BuildBitmap();
+
+  std::cout << "GoodRunsCache : " << GetNRuns() << " runs, "
+	    << GetNIntervals() << " lumi block ranges" << std::endl;
+
+  return true;
+}
+
+/** @brief Get size and modification time of xml files
+ *
+ *  @param1 vector of GRL xml files
+ *
+ *  @return true if all files exist
+ */
+bool YKAnalysis :: GoodRunsCache :: ReadSources( const std::vector< std::string >& xmlFiles )
+{
+  m_v_sources.clear();
+
+  for( auto& xmlFile : xmlFiles ){
+    TString path = xmlFile;
+    gSystem->ExpandPathName( path );
+
+    Long_t   id, flags, mtime;
+    Long64_t size;
+    if( gSystem->GetPathInfo( path.Data(), &id, &size, &flags, &mtime ) ){
+      std::cerr << "GoodRunsCache : Cannot find " << path << std::endl;
+      return false;
+    }
+    m_v_sources.push_back( Source{ path.Data(), size, mtime } );
+  }
+
+  return !m_v_sources.empty();
+}
+
+/** @brief Read binary cache
+ *
+ *  @param1 name of binary cache file
+ *
+ *  @return true if cache exists and is up to date
+ */
+bool YKAnalysis :: GoodRunsCache :: ReadCache( const std::string& cacheFile )
+{
+  std::ifstream in( cacheFile.c_str(), std::ios::binary );
+  if( !in ) return false;
+
+  char     magic[8];
+  uint32_t version = 0, nSources = 0, nIntervals = 0;
+
+  in.read( magic, sizeof(magic) );
+  in.read( reinterpret_cast<char*>( &version  ), sizeof(version ) );
+  if( !in || std::memcmp( magic, s_magic, sizeof(magic) ) || version != s_version )
+    return false;
+
+  in.read( reinterpret_cast<char*>( &nSources ), sizeof(nSources) );
+  if( !in || nSources != m_v_sources.size() ) return false;
+
+  for( auto& source : m_v_sources ){
+    uint32_t len = 0;
+    Long64_t size = 0, mtime = 0;
+    in.read( reinterpret_cast<char*>( &len ), sizeof(len) );
+    if( !in || len > 4096 ) return false;
+    std::string path( len, ' ' );
+    in.read( &path[0], len );
+    in.read( reinterpret_cast<char*>( &size  ), sizeof(size ) );
+    in.read( reinterpret_cast<char*>( &mtime ), sizeof(mtime) );
+    if( !in || path != source.path || size != source.size || mtime != source.mtime )
+      return false;
+  }
+
+  in.read( reinterpret_cast<char*>( &nIntervals ), sizeof(nIntervals) );
+  if( !in ) return false;
+
+  m_v_intervals.resize( nIntervals );
+  in.read( reinterpret_cast<char*>( m_v_intervals.data() ), nIntervals * sizeof(Interval) );
+  if( !in ){ m_v_intervals.clear(); return false; }
+
+  return true;
+}
+
+/** @brief Write binary cache
+ *
+ *  @param1 name of binary cache file
+ *
+ *  @return true if successful
+ */
+bool YKAnalysis :: GoodRunsCache :: WriteCache( const std::string& cacheFile ) const
+{
+  std::ofstream out( cacheFile.c_str(), std::ios::binary | std::ios::trunc );
+  if( !out ) return false;
+
+  uint32_t nSources   = m_v_sources.size();
+  uint32_t nIntervals = m_v_intervals.size();
+
+  out.write( s_magic, sizeof(s_magic) );
+  out.write( reinterpret_cast<const char*>( &s_version ), sizeof(s_version) );
+  out.write( reinterpret_cast<const char*>( &nSources  ), sizeof(nSources ) );
+  for( auto& source : m_v_sources ){
+    uint32_t len = source.path.size();
+    out.write( reinterpret_cast<const char*>( &len ), sizeof(len) );
+    out.write( source.path.data(), len );
+    out.write( reinterpret_cast<const char*>( &source.size  ), sizeof(source.size ) );
+    out.write( reinterpret_cast<const char*>( &source.mtime ), sizeof(source.mtime) );
+  }
+  out.write( reinterpret_cast<const char*>( &nIntervals ), sizeof(nIntervals) );
+  out.write( reinterpret_cast<const char*>( m_v_intervals.data() ),
+	     nIntervals * sizeof(Interval) );
+
+  return out.good();
+}
+
+/** @brief Parse xml files
+ *
+ *  Lists are merged with OR, same as
+ *  GoodRunsListSelectionTool does.
+ *
+ *  @return true if successful
+ */
+bool YKAnalysis :: GoodRunsCache :: ReadXML()
+{
+  Root::TGoodRunsListReader reader;
+  for( auto& source : m_v_sources ){
+    std::cout << "GoodRunsCache : Reading " << source.path << std::endl;
+    reader.AddXMLFile( source.path.c_str() );
+  }
+  if( !reader.Interpret() ){
+    std::cerr << "GoodRunsCache : Could not interpret GRL xml" << std::endl;
+    return false;
+  }
+
+  const Root::TGoodRunsList grl = reader.GetMergedGoodRunsList();
+
+  m_v_intervals.clear();
+  for( auto& run : grl ){
+    for( auto& range : run.second ){
+      m_v_intervals.push_back( Interval{ run.first, range.Begin(), range.End() } );
+    }
+  }
+
+  return true;
+}
+
+/** @brief Build bitmap from intervals
+ *
+ *  Each run gets a contiguous block of
+ *  bits, one per lumi block up to its last good one.
+ *  Open-ended ranges get no bits, only a start.
+ *
+ *  @return void
+ */
+void YKAnalysis :: GoodRunsCache :: BuildBitmap()
+{
+  m_m_runs.clear();
+  m_bits.clear();
+  m_lastRun = -1;
+
+  // find last good lumi block of closed ranges, and
+  // start of open-ended ranges (End() is INT_MAX), per run
+  std::unordered_map< int, int > lastLBOfRun;
+  std::unordered_map< int, int > openFromOfRun;
+  for( auto& interval : m_v_intervals ){
+    int& lastLB = lastLBOfRun[ interval.run ];
+    auto itr    = openFromOfRun.emplace( interval.run, INT32_MAX ).first;
+
+    if( interval.lbEnd > s_maxLB )
+      itr->second = std::min( itr->second, std::max( 0, interval.lbBegin ) );
+    else
+      lastLB = std::max( lastLB, interval.lbEnd );
+  }
+
+  uint64_t nBits = 0;
+  for( auto& run : lastLBOfRun ){
+    int openFrom = openFromOfRun[ run.first ];
+    int nLB      = std::min( run.second + 1, openFrom );
+    m_m_runs[ run.first ] = RunEntry{ nBits, nLB, openFrom };
+    nBits += nLB;
+  }
+
+  m_bits.assign( ( nBits + 63 ) / 64, 0 );
+
+  for( auto& interval : m_v_intervals ){
+    const RunEntry& entry = m_m_runs[ interval.run ];
+    int lbEnd = std::min( interval.lbEnd, entry.nLB - 1 );
+    for( int lb = std::max( 0, interval.lbBegin ); lb <= lbEnd; lb++ ){
+      uint64_t bit = entry.offset + lb;
+      m_bits[ bit >> 6 ] |= ( uint64_t(1) << ( bit & 63 ) );
+    }
+  }
+}
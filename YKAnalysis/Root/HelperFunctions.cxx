@@ -3,17 +3,16 @@
  */
 
 #include "YKAnalysis/HelperFunctions.h"
+#include "YKAnalysis/Kinematics.h"
 
 bool descendingPt(xAOD::Jet* a, xAOD::Jet* b) { return a->pt() > b->pt(); }
 
 float deltaPhi(const xAOD::Jet& j1, const xAOD::Jet& j2) { 
-  return TVector2::Phi_mpi_pi(j1.phi()-j2.phi());
+  return YKAnalysis::Kinematics::DeltaPhi(j1.phi(), j2.phi());
 }
 
 float deltaR(const xAOD::Jet &j1, const xAOD::Jet &j2){
-  float deta = j1.eta()-j2.eta();
-  float dphi = TVector2::Phi_mpi_pi(j1.phi()-j2.phi());
-  return TMath::Sqrt( deta*deta+dphi*dphi );
+  return YKAnalysis::Kinematics::DeltaR(j1.eta(), j1.phi(), j2.eta(), j2.phi());
 }
 
 TH1F* createHist1D(TString hname, TString title, int nbins, int xlow, int xhigh) {
@@ -66,3 +65,10 @@ std::vector<double> makeUniformVec(int N, double min, double max) {
   for (int i=0;i<=N;++i) vec.push_back(min+i*dx);
   return vec;
 }
+
+void printInitTime(const std::string& caller, const std::string& tool, TStopwatch& sw) {
+  sw.Stop();
+  printf("%s : %-32s initialized in %6.2f s (cpu %6.2f s)\n",
+	 caller.c_str(), tool.c_str(), sw.RealTime(), sw.CpuTime());
+  sw.Start(kTRUE);
+}
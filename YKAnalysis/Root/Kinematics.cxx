@@ -0,0 +1,226 @@
+/** @file Kinematics.cxx
+ *  @brief Implementation of Kinematics.
+ *
+ *  Batch deltaPhi, deltaR^2 and cone masks for one
+ *  reference (eta0, phi0) against arrays of candidates.
+ *  Inputs are structure-of-arrays so the SSE2 kernels can
+ *  load four candidates at a time. The scalar kernels do
+ *  the same float operations in the same order and are
+ *  used for the tail, when SIMD is not built, or when the
+ *  caller passes useSIMD = false. There is no global state.
+ *
+ *  Phi is assumed to be in [-pi, pi], as it comes from xAOD.
+ *
+ *  @author Yakov Kulinich
+ *  @bug No known bugs.
+ */
+
+#include "YKAnalysis/Kinematics.h"
+
+#include <cmath>
+
+#if defined(__SSE2__) && !defined(YKANALYSIS_NO_SIMD)
+#define YKANALYSIS_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+  const float s_pi    = 3.14159265358979f;
+  const float s_twoPi = 6.28318530717959f;
+
+  // |dphi| folded into [0, pi]
+  inline float AbsDeltaPhi( float phi0, float phi )
+  {
+    float dPhi = std::fabs( phi0 - phi );
+    return dPhi > s_pi ? s_twoPi - dPhi : dPhi;
+  }
+
+  void DeltaPhiScalar( float phi0, const float* phi, std::size_t i, std::size_t n, float* out )
+  {
+    for( ; i < n; i++ ) out[i] = YKAnalysis::Kinematics::DeltaPhi( phi0, phi[i] );
+  }
+
+  void DeltaR2Scalar( float eta0, float phi0, const float* eta, const float* phi,
+		      std::size_t i, std::size_t n, float* out )
+  {
+    for( ; i < n; i++ ){
+      float dEta = eta0 - eta[i];
+      float dPhi = AbsDeltaPhi( phi0, phi[i] );
+      out[i] = dEta * dEta + dPhi * dPhi;
+    }
+  }
+
+  std::size_t ConeMaskScalar( float eta0, float phi0, float R2, const float* eta, const float* phi,
+			      std::size_t i, std::size_t n, unsigned char* mask )
+  {
+    std::size_t nPass = 0;
+    for( ; i < n; i++ ){
+      float dEta = eta0 - eta[i];
+      float dPhi = AbsDeltaPhi( phi0, phi[i] );
+      mask[i] = ( dEta * dEta + dPhi * dPhi ) <= R2;
+      nPass  += mask[i];
+    }
+    return nPass;
+  }
+
+#ifdef YKANALYSIS_SSE2
+  // |phi0 - phi| folded into [0, pi], four at a time
+  inline __m128 AbsDeltaPhi4( __m128 vPhi0, __m128 vPhi )
+  {
+    const __m128 vAbs   = _mm_castsi128_ps( _mm_set1_epi32( 0x7fffffff ) );
+    const __m128 vPi    = _mm_set1_ps( s_pi    );
+    const __m128 vTwoPi = _mm_set1_ps( s_twoPi );
+    __m128 dPhi = _mm_and_ps( _mm_sub_ps( vPhi0, vPhi ), vAbs );
+    __m128 wrap = _mm_cmpgt_ps( dPhi, vPi );
+    return _mm_or_ps( _mm_andnot_ps( wrap, dPhi ),
+		      _mm_and_ps   ( wrap, _mm_sub_ps( vTwoPi, dPhi ) ) );
+  }
+
+  inline __m128 DeltaR24( __m128 vEta0, __m128 vPhi0, const float* eta, const float* phi )
+  {
+    __m128 dEta = _mm_sub_ps( vEta0, _mm_loadu_ps( eta ) );
+    __m128 dPhi = AbsDeltaPhi4( vPhi0, _mm_loadu_ps( phi ) );
+    return _mm_add_ps( _mm_mul_ps( dEta, dEta ), _mm_mul_ps( dPhi, dPhi ) );
+  }
+#endif
+
+}
+
+/** @brief deltaPhi in [-pi, pi)
+ */
+float YKAnalysis :: Kinematics :: DeltaPhi( float phi1, float phi2 )
+{
+  float dPhi = phi1 - phi2;
+  if     ( dPhi >= s_pi ) dPhi -= s_twoPi;
+  else if( dPhi < -s_pi ) dPhi += s_twoPi;
+  return dPhi;
+}
+
+/** @brief deltaR^2 = deltaEta^2 + deltaPhi^2
+ */
+float YKAnalysis :: Kinematics :: DeltaR2( float eta1, float phi1, float eta2, float phi2 )
+{
+  float dEta = eta1 - eta2;
+  float dPhi = AbsDeltaPhi( phi1, phi2 );
+  return dEta * dEta + dPhi * dPhi;
+}
+
+/** @brief deltaR = sqrt( deltaEta^2 + deltaPhi^2 )
+ */
+float YKAnalysis :: Kinematics :: DeltaR( float eta1, float phi1, float eta2, float phi2 )
+{
+  return std::sqrt( DeltaR2( eta1, phi1, eta2, phi2 ) );
+}
+
+/** @brief deltaPhi of reference and candidates
+ *
+ *  @param1 reference phi
+ *  @param2 candidate phis
+ *  @param3 number of candidates
+ *  @param4 output, phi0 - phi[i] in [-pi, pi)
+ *  @param5 use SIMD kernels if built
+ *
+ *  @return void
+ */
+void YKAnalysis :: Kinematics :: DeltaPhiBatch( float phi0, const float* phi, std::size_t n, float* out,
+					       bool useSIMD )
+{
+  std::size_t i = 0;
+#ifdef YKANALYSIS_SSE2
+  if( useSIMD ){
+    const __m128 vPhi0     = _mm_set1_ps( phi0     );
+    const __m128 vPi       = _mm_set1_ps( s_pi     );
+    const __m128 vMinusPi  = _mm_set1_ps( -s_pi    );
+    const __m128 vTwoPi    = _mm_set1_ps( s_twoPi  );
+    for( ; i + 4 <= n; i += 4 ){
+      __m128 dPhi = _mm_sub_ps( vPhi0, _mm_loadu_ps( phi + i ) );
+      __m128 high = _mm_and_ps( _mm_cmpge_ps( dPhi, vPi      ), vTwoPi );
+      __m128 low  = _mm_and_ps( _mm_cmplt_ps( dPhi, vMinusPi ), vTwoPi );
+      _mm_storeu_ps( out + i, _mm_add_ps( _mm_sub_ps( dPhi, high ), low ) );
+    }
+  }
+#endif
+  DeltaPhiScalar( phi0, phi, i, n, out );
+}
+
+/** @brief deltaR^2 of reference and candidates
+ *
+ *  @param1 reference eta
+ *  @param2 reference phi
+ *  @param3 candidate etas
+ *  @param4 candidate phis
+ *  @param5 number of candidates
+ *  @param6 output deltaR^2
+ *  @param7 use SIMD kernels if built
+ *
+ *  @return void
+ */
+void YKAnalysis :: Kinematics :: DeltaR2Batch( float eta0, float phi0,
+					       const float* eta, const float* phi,
+					       std::size_t n, float* out, bool useSIMD )
+{
+  std::size_t i = 0;
+#ifdef YKANALYSIS_SSE2
+  if( useSIMD ){
+    const __m128 vEta0 = _mm_set1_ps( eta0 );
+    const __m128 vPhi0 = _mm_set1_ps( phi0 );
+    for( ; i + 4 <= n; i += 4 ){
+      _mm_storeu_ps( out + i, DeltaR24( vEta0, vPhi0, eta + i, phi + i ) );
+    }
+  }
+#endif
+  DeltaR2Scalar( eta0, phi0, eta, phi, i, n, out );
+}
+
+/** @brief Mask of candidates in a cone
+ *
+ *  @param1 reference eta
+ *  @param2 reference phi
+ *  @param3 cone radius (deltaR <= R passes)
+ *  @param4 candidate etas
+ *  @param5 candidate phis
+ *  @param6 number of candidates
+ *  @param7 output mask, 1 if in cone
+ *  @param8 use SIMD kernels if built
+ *
+ *  @return number of candidates in cone
+ */
+std::size_t YKAnalysis :: Kinematics :: ConeMask( float eta0, float phi0, float R,
+						  const float* eta, const float* phi,
+						  std::size_t n, unsigned char* mask, bool useSIMD )
+{
+  std::size_t i     = 0;
+  std::size_t nPass = 0;
+  float       R2    = R * R;
+#ifdef YKANALYSIS_SSE2
+  if( useSIMD ){
+    const __m128 vEta0 = _mm_set1_ps( eta0 );
+    const __m128 vPhi0 = _mm_set1_ps( phi0 );
+    const __m128 vR2   = _mm_set1_ps( R2   );
+    for( ; i + 4 <= n; i += 4 ){
+      int bits = _mm_movemask_ps( _mm_cmple_ps( DeltaR24( vEta0, vPhi0, eta + i, phi + i ), vR2 ) );
+      mask[i  ] =   bits        & 1;
+      mask[i+1] = ( bits >> 1 ) & 1;
+      mask[i+2] = ( bits >> 2 ) & 1;
+      mask[i+3] = ( bits >> 3 ) & 1;
+      nPass += mask[i] + mask[i+1] + mask[i+2] + mask[i+3];
+    }
+  }
+#endif
+  return nPass + ConeMaskScalar( eta0, phi0, R2, eta, phi, i, n, mask );
+}
+
+bool YKAnalysis :: Kinematics :: HaveSIMD()
+{
+#ifdef YKANALYSIS_SSE2
+  return true;
+#else
+  return false;
+#endif
+}
+
+const char* YKAnalysis :: Kinematics :: Backend( bool useSIMD )
+{
+  return useSIMD && HaveSIMD() ? "SSE2" : "scalar";
+}
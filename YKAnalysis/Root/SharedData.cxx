@@ -10,6 +10,35 @@
  *  @bug No known bugs.
  */
 #include "YKAnalysis/SharedData.h"
+#include "YKAnalysis/TrackCache.h"
+#include "YKAnalysis/EventShape.h"
+#include "YKAnalysis/Analysis.h"
+
+#include <TDirectory.h>
+#include <TBasket.h>
+#include <TBuffer.h>
+#include <TLeaf.h>
+
+#include <set>
+
+namespace {
+  // bytes in the current (unwritten) baskets of all branches
+  Long64_t BasketBytes( TTree* tree )
+  {
+    std::set< TBranch* > branches;
+    TObjArray* leaves = tree->GetListOfLeaves();
+    for( int i = 0; i < leaves->GetEntriesFast(); i++ )
+      branches.insert( static_cast< TLeaf* >( leaves->UncheckedAt( i ) )->GetBranch() );
+
+    Long64_t bytes = 0;
+    for( auto& branch : branches ){
+      TBasket* basket = branch->GetBasket( branch->GetWriteBasket() );
+      if( basket && basket->GetBufferRef() )
+	bytes += basket->GetBufferRef()->Length() - basket->GetKeylen();
+    }
+    return bytes;
+  }
+}
 
 /** @brief Default Constructor for SharedData.
  */
@@ -21,7 +50,12 @@ YKAnalysis :: SharedData :: SharedData ()
      m_fout(NULL),
      m_tree(NULL),
      m_config(NULL),
-     m_hEventStatistics(NULL)
+     m_hEventStatistics(NULL),
+     m_trackCache(NULL),
+     m_eventShape(NULL),
+     m_outputFlushBytes(0),
+     m_outputAutoSaveBytes(0),
+     m_savedBytes(0)
 {}
 
 /** @brief Constructor for SharedData.
@@ -40,7 +74,12 @@ YKAnalysis :: SharedData :: SharedData ( const std::string& outputFileName,
      m_fout(NULL),
      m_tree(NULL),
      m_config(NULL),
-     m_hEventStatistics(NULL)
+     m_hEventStatistics(NULL),
+     m_trackCache(NULL),
+     m_eventShape(NULL),
+     m_outputFlushBytes(0),
+     m_outputAutoSaveBytes(0),
+     m_savedBytes(0)
 {}
 
 /** @brief Destructor for SharedData.
@@ -51,30 +90,53 @@ YKAnalysis :: SharedData :: ~SharedData()
 {
   delete m_eventStore;
   delete m_tree;
+  for( auto& f : m_v_streamFiles ) { delete f; }
   delete m_fout;
   delete m_config;
+  delete m_trackCache;
+  delete m_eventShape;
 }
 
 /** @brief Function to add an event store.
  *
  *  Initialize TFile, Tree, TEnv (config) 
  *
+ *  The output memory policy is read from the config:
+ *  outputFlushMB    - TTree::SetAutoFlush, flush baskets once
+ *                     this many MB are buffered (0 = ROOT default)
+ *  outputAutoSaveMB - TTree::SetAutoSave, write tree header once
+ *                     this many MB are on file, histograms are
+ *                     written with it (0 = ROOT default)
+ *
  *  @return void
  */
 static const int n_eventStatistics = 10;
 
 void YKAnalysis :: SharedData :: Initialize()
 {
-  m_fout         = new TFile( m_outputFileName.c_str(), "RECREATE" );
-  m_tree         = new TTree( "tree"                  , "tree"     );
-
   m_config       = new TEnv ();
   m_config->ReadFile( m_configFileName.c_str(), EEnvLevel(0));
 
   std::cout << m_config << " " << m_configFileName << std::endl;
 
+  m_outputFlushBytes    = 
+    static_cast<Long64_t>( m_config->GetValue( "outputFlushMB"   , 0 ) ) * 1024 * 1024;
+  m_outputAutoSaveBytes = 
+    static_cast<Long64_t>( m_config->GetValue( "outputAutoSaveMB", 0 ) ) * 1024 * 1024;
+
+  m_fout         = new TFile( m_outputFileName.c_str(), "RECREATE" );
+  m_tree         = new TTree( "tree"                  , "tree"     );
+  
+  SetOutputPolicy( m_tree );
+
+  std::cout << "Output flush every " << m_outputFlushBytes << " bytes, "
+	    << "autosave every "     << m_outputAutoSaveBytes << " bytes" << std::endl;
+
   m_hEventStatistics = new TH1D( "hEventStatistics","hEventStatistics", 
 				 n_eventStatistics, 0, n_eventStatistics );
+
+  m_trackCache   = new TrackCache();
+  m_eventShape   = new EventShape();
 }
 
 /** @brief Function to add an event store.
@@ -101,19 +163,242 @@ void YKAnalysis :: SharedData :: AddOutputHistogram( TH1* h )
 {
   m_v_hists.push_back( h );
 }
+
+/** @brief Function to add any other output object.
+ *
+ *  For objects that are not TH1, i.e. THnSparse.
+ *  Written with the histograms.
+ *
+ *  @param1 Pointer to object
+ *
+ *  @return void
+ */
+void YKAnalysis :: SharedData :: AddOutputObject( TObject* obj )
+{
+  m_v_hists.push_back( obj );
+}
+
+/** @brief Function to add an autosave listener.
+ *
+ *  Its OnAutoSave is called before the histograms
+ *  are written at each autosave, so it can flush
+ *  anything it buffers.
+ *
+ *  @param1 Pointer to analysis
+ *
+ *  @return void
+ */
+void YKAnalysis :: SharedData :: AddAutoSaveListener( Analysis* analysis )
+{
+  m_v_autoSaveListeners.push_back( analysis );
+}
+
+/** @brief Function to add a C array branch to the tree
+ *
+ *  For flat arrays described by a leaf list, 
+ *  i.e. "x[n]/F" with n another branch. The caller
+ *  owns the buffer and must call SetAddress on the
+ *  returned branch if it moves.
+ *
+ *  @param1 Name of branch
+ *  @param2 Address of buffer
+ *  @param3 Leaf list
+ *  @param4 Name of output tree (default is main tree)
+ *
+ *  @return pointer to the branch
+ */
+TBranch* YKAnalysis :: SharedData :: AddOutputArrayToTree( const std::string& name, void* address,
+							   const std::string& leafList,
+							   const std::string& treeName )
+{
+  TTree* tree = GetOutputTree( treeName );
+  std::cout << "Adding " << name << " to " << tree->GetName() << std::endl;
+  TBranch* branch = tree->Branch( name.c_str(), address, leafList.c_str() );
+
+  auto itr = m_m_streamCompression.find( tree->GetName() );
+  if( branch && itr != m_m_streamCompression.end() )
+    { branch->SetCompressionSettings( itr->second ); }
+
+  return branch;
+}
+/** @brief Function to add an output tree.
+ *
+ *  Creates a new output tree which is filled in step
+ *  with the main tree, so entries are aligned one-to-one, 
+ *  and registers it as a friend of the main tree.
+ *  If a file name is given, the tree is written
+ *  to that file instead of the main output file.
+ *
+ *  @param1 Name of tree
+ *  @param2 Name of output file (default is main output file)
+ *  @param3 Compression settings (default is file setting)
+ *
+ *  @return pointer to the tree
+ */
+TTree* YKAnalysis :: SharedData :: AddOutputTree( const std::string& treeName,
+						  const std::string& fileName,
+						  int compression )
+{
+  if( treeName.empty() || treeName == m_tree->GetName() ) return m_tree;
+  for( auto& t : m_v_streamTrees ){
+    if( treeName == t->GetName() ) return t;
+  }
+  
+  TDirectory::TContext ctx( m_fout );
+  
+  if( !fileName.empty() && fileName != m_outputFileName ){
+    TFile* f = new TFile( fileName.c_str(), "RECREATE" );
+    if( compression >= 0 ) { f->SetCompressionSettings( compression ); }
+    m_v_streamFiles.push_back( f );
+    f->cd();
+  }
+  
+  TTree* tree = new TTree( treeName.c_str(), treeName.c_str() );
+  SetOutputPolicy( tree );
+  if( compression >= 0 ) { m_m_streamCompression[ treeName ] = compression; }
+
+  m_tree->AddFriend( tree );
+  m_v_streamTrees.push_back( tree );
+  
+  std::cout << "Output stream " << treeName << " -> " 
+	    << tree->GetDirectory()->GetFile()->GetName() << std::endl;
+  
+  return tree;
+}
+
+/** @brief Function to get an output tree.
+ *
+ *  Creates it if it does not yet exist.
+ *
+ *  @param1 Name of tree (default is main tree)
+ *
+ *  @return pointer to the tree
+ */
+TTree* YKAnalysis :: SharedData :: GetOutputTree( const std::string& treeName )
+{
+  return AddOutputTree( treeName );
+}
+
+/** @brief Function to get output stream of an analysis.
+ *
+ *  Reads from config which tree an analysis writes to.
+ *  outputStream.<analysis>          - name of tree
+ *  outputStreamFile.<tree>          - file to write tree to
+ *  outputStreamCompression.<tree>   - compression settings 
+ *
+ *  Analysis without an entry write to the main tree.
+ *
+ *  @param1 Name of analysis
+ *
+ *  @return name of tree
+ */
+std::string YKAnalysis :: SharedData :: GetOutputStream( const std::string& analysisName )
+{
+  std::string treeName = 
+    m_config->GetValue( Form( "outputStream.%s", analysisName.c_str() ), m_tree->GetName() );
+  std::string fileName = 
+    m_config->GetValue( Form( "outputStreamFile.%s", treeName.c_str() ), "" );
+  int compression =
+    m_config->GetValue( Form( "outputStreamCompression.%s", treeName.c_str() ), -1 );
+
+  AddOutputTree( treeName, fileName, compression );
+  
+  return treeName;
+}
+
 /** @brief End of event
  *
  *  Fill the tree if we had a good event. 
+ *  Clear per event caches.
  *  Increment event counter 
  *
  *  @return void 
  */
 void YKAnalysis :: SharedData :: EndOfEvent( bool goodEvent )
 {
-  if( goodEvent ) m_tree->Fill();
+  if( goodEvent ){
+    m_tree->Fill();
+    // keep streams aligned entry by entry with main tree
+    for( auto& t : m_v_streamTrees ) { t->Fill(); }
+
+    // main tree was autosaved during Fill
+    if( m_tree->GetSavedBytes() != m_savedBytes ){
+      m_savedBytes = m_tree->GetSavedBytes();
+      AutoSaveOutput();
+    }
+  }
+  m_trackCache->Clear();
+  m_eventShape->Clear();
   m_eventCounter++;
 }
 
+/** @brief FCal sum Et of this event
+ *
+ *  Layers 21-23, both sides, see EventShape.
+ *
+ *  @return FCal Et in TeV, 0 if not retrieved yet
+ */
+double YKAnalysis :: SharedData :: GetFCalEt () const
+{
+  if( !m_eventShape || !m_eventShape->IsFilled() ) return 0;
+  return m_eventShape->GetFCalEt() * 1e-6;
+}
+
+/** @brief Output buffer footprint
+ *
+ *  Bytes filled into the current baskets of the main
+ *  tree and the output streams, i.e. what is held in
+ *  memory until the next flush.
+ *
+ *  @return bytes
+ */
+Long64_t YKAnalysis :: SharedData :: GetOutputBufferSize () const
+{
+  if( !m_tree ) return 0;
+  Long64_t bytes = BasketBytes( m_tree );
+  for( auto& t : m_v_streamTrees ) { bytes += BasketBytes( t ); }
+  return bytes;
+}
+
+/** @brief Set flush and autosave policy of a tree
+ *
+ *  Negative values are bytes for ROOT, so baskets are
+ *  flushed in aligned clusters and the header saved by
+ *  the tree itself.
+ *
+ *  @param1 output tree
+ *
+ *  @return void 
+ */
+void YKAnalysis :: SharedData :: SetOutputPolicy( TTree* tree )
+{
+  if( m_outputFlushBytes    > 0 ){ tree->SetAutoFlush( -m_outputFlushBytes    ); }
+  if( m_outputAutoSaveBytes > 0 ){ tree->SetAutoSave ( -m_outputAutoSaveBytes ); }
+}
+
+/** @brief AutoSave output 
+ *
+ *  Called after the main tree autosaved itself.
+ *  Listeners flush their buffers, then the current
+ *  state of all histograms is written to the output file. Overwrites the previous cycle so there
+ *  is only ever one copy of each on file. If the job
+ *  dies, the output is readable up to here.
+ *
+ *  @return void 
+ */
+void YKAnalysis :: SharedData :: AutoSaveOutput()
+{
+  for( auto& analysis : m_v_autoSaveListeners ) { analysis->OnAutoSave(); }
+
+  std::cout << "Output autosaved at event " << m_eventCounter << ", "
+	    << GetOutputBufferSize() << " bytes buffered" << std::endl;
+
+  TDirectory::TContext ctx( m_fout );
+  
+  for( auto& h : m_v_hists ) { h->Write( "", TObject::kOverwrite ); }
+  m_hEventStatistics->Write( "", TObject::kOverwrite );
+}
+
 /** @brief Function to check if printing necessary
  *
  *  Print every event until 10, then every 10,
@@ -144,16 +429,27 @@ bool YKAnalysis :: SharedData :: DoPrint()
  */
 void YKAnalysis :: SharedData :: Finalize() 
 {
+  std::cout << "Output flush every " << m_outputFlushBytes << " bytes, "
+	    << "autosave every "     << m_outputAutoSaveBytes << " bytes, "
+	    << GetOutputBufferSize() << " bytes buffered at end" << std::endl;
+
+  // write output streams, each to its own file
+  for( auto& t : m_v_streamTrees ){
+    t->GetDirectory()->cd();
+    t->Write( "", TObject::kOverwrite );
+  }
+  
   m_fout->cd();
 
   // write tree
-  m_tree->Write();
+  m_tree->Write( "", TObject::kOverwrite );
 
   // write all histos from various analysis
-  for( auto& h : m_v_hists ) { h->Write(); }
+  for( auto& h : m_v_hists ) { h->Write( "", TObject::kOverwrite ); }
   
   // write common statistics histo
-  m_hEventStatistics->Write();
+  m_hEventStatistics->Write( "", TObject::kOverwrite );
 
   m_fout->Close();
+  for( auto& f : m_v_streamFiles ) { f->Close(); }
 }
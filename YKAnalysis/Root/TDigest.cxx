@@ -0,0 +1,270 @@
+/** @file TDigest.cxx
+ *  @brief Implementation of TDigest.
+ *
+ *  TDigest is a merging t-digest (Dunning), a streaming
+ *  quantile sketch. Values are buffered and from time to
+ *  time merged into a sorted list of centroids (mean, weight).
+ *  The k1 scale function keeps centroids small near the
+ *  tails, so extreme quantiles (e.g. the most central
+ *  percent of events) are the most accurate. The number of
+ *  centroids stays below about compression * pi / 2, so memory
+ *  is bounded no matter how many values are added.
+ *
+ *  Digests merge by adding each other's centroids, so
+ *  digests from several jobs or threads give the digest
+ *  of all of their values. Written as a tree with one
+ *  entry per centroid, the outputs of several jobs can
+ *  be hadd'ed and read back as one.
+ *
+ *  @author Yakov Kulinich
+ *  @bug No known bugs.
+ */
+
+#include "YKAnalysis/TDigest.h"
+
+#include <TTree.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+namespace {
+  // k1 scale function and inverse
+  inline double ScaleK ( double q, double compression )
+  { return compression / ( 2 * M_PI ) * std::asin( 2 * q - 1 ); }
+  inline double ScaleQ ( double k, double compression )
+  {
+    if( k >= compression / 4 ) return 1;
+    return ( std::sin( k * 2 * M_PI / compression ) + 1 ) / 2;
+  }
+}
+
+/** @brief Default Constructor for TDigest.
+ */
+YKAnalysis :: TDigest :: TDigest ()
+  : TDigest( 200 )
+{}
+
+/** @brief Constructor for TDigest.
+ *
+ *  @param1 compression, larger is more accurate and bigger
+ */
+YKAnalysis :: TDigest :: TDigest ( double compression )
+  : m_compression( compression > 10 ? compression : 10 ),
+    m_bufferSize ( 5 * std::size_t( m_compression ) ),
+    m_totalWeight( 0 ),
+    m_min        (  std::numeric_limits< double >::infinity() ),
+    m_max        ( -std::numeric_limits< double >::infinity() ),
+    m_treeMean   ( 0 ), m_treeWeight( 0 ), m_treeMin( 0 ), m_treeMax( 0 )
+{
+  m_v_buffer.reserve( m_bufferSize );
+}
+
+/** @brief Destructor for TDigest.
+ */
+YKAnalysis :: TDigest :: ~TDigest ()
+{}
+
+/** @brief Add a value
+ *
+ *  @param1 value
+ *  @param2 weight
+ *
+ *  @return void
+ */
+void YKAnalysis :: TDigest :: Add ( double x, double w )
+{
+  if( !( w > 0 ) || std::isnan( x ) ) return;
+
+  m_v_buffer.push_back( Centroid{ x, w } );
+  m_totalWeight += w;
+  if( x < m_min ) m_min = x;
+  if( x > m_max ) m_max = x;
+
+  if( m_v_buffer.size() >= m_bufferSize ) Compress();
+}
+
+/** @brief Add all values of another digest
+ *
+ *  @param1 other digest
+ *
+ *  @return void
+ */
+void YKAnalysis :: TDigest :: Merge ( const TDigest& other )
+{
+  for( auto& c : other.m_v_centroids ) { m_v_buffer.push_back( c ); m_totalWeight += c.weight; }
+  for( auto& c : other.m_v_buffer    ) { m_v_buffer.push_back( c ); m_totalWeight += c.weight; }
+  m_min = std::min( m_min, other.m_min );
+  m_max = std::max( m_max, other.m_max );
+  Compress();
+}
+
+/** @brief Merge buffer into centroids
+ *
+ *  @return void
+ */
+void YKAnalysis :: TDigest :: Compress ()
+{
+  if( m_v_buffer.empty() ) return;
+
+  m_v_merge.clear();
+  m_v_merge.insert( m_v_merge.end(), m_v_centroids.begin(), m_v_centroids.end() );
+  m_v_merge.insert( m_v_merge.end(), m_v_buffer   .begin(), m_v_buffer   .end() );
+  m_v_buffer.clear();
+  std::sort( m_v_merge.begin(), m_v_merge.end() );
+
+  m_v_centroids.clear();
+
+  double   weightSoFar = 0;
+  double   qLimit      = ScaleQ( ScaleK( 0, m_compression ) + 1, m_compression );
+  Centroid current     = m_v_merge.front();
+  
+  for( std::size_t i = 1; i < m_v_merge.size(); i++ ){
+    const Centroid& next = m_v_merge[i];
+    double q = ( weightSoFar + current.weight + next.weight ) / m_totalWeight;
+    if( q <= qLimit ){
+      current.weight += next.weight;
+      current.mean   += ( next.mean - current.mean ) * next.weight / current.weight;
+    } else {
+      m_v_centroids.push_back( current );
+      weightSoFar += current.weight;
+      qLimit  = ScaleQ( ScaleK( weightSoFar / m_totalWeight, m_compression ) + 1, m_compression );
+      current = next;
+    }
+  }
+  m_v_centroids.push_back( current );
+}
+
+/** @brief Number of centroids
+ *
+ *  @return number of centroids after merging buffer
+ */
+std::size_t YKAnalysis :: TDigest :: GetNCentroids ()
+{
+  Compress();
+  return m_v_centroids.size();
+}
+
+/** @brief Value at quantile
+ *
+ *  Interpolates linearly between centroid centers,
+ *  and between the outer centroids and min / max.
+ *
+ *  @param1 quantile in [0,1]
+ *
+ *  @return value, NaN if empty
+ */
+double YKAnalysis :: TDigest :: Quantile ( double q )
+{
+  Compress();
+  if( m_v_centroids.empty() ) return std::numeric_limits< double >::quiet_NaN();
+  if( q <= 0 ) return m_min;
+  if( q >= 1 ) return m_max;
+
+  double index = q * m_totalWeight;
+
+  // cumulative weight at center of centroid
+  double prevPos  = 0;
+  double prevMean = m_min;
+  double cumWeight = 0;
+  for( auto& c : m_v_centroids ){
+    double pos = cumWeight + c.weight / 2;
+    if( index < pos ){
+      return pos > prevPos ?
+	prevMean + ( c.mean - prevMean ) * ( index - prevPos ) / ( pos - prevPos ) : c.mean;
+    }
+    prevPos   = pos;
+    prevMean  = c.mean;
+    cumWeight += c.weight;
+  }
+  return m_totalWeight > prevPos ?
+    prevMean + ( m_max - prevMean ) * ( index - prevPos ) / ( m_totalWeight - prevPos ) : m_max;
+}
+
+/** @brief Make an empty tree for WriteToTree
+ *
+ *  @param1 tree name
+ *
+ *  @return new tree, owned by caller (or its directory)
+ */
+TTree* YKAnalysis :: TDigest :: MakeTree ( const std::string& name )
+{
+  TTree* tree = new TTree( name.c_str(), "t-digest centroids" );
+  tree->Branch( "mean"  , &m_treeMean  , "mean/D"   );
+  tree->Branch( "weight", &m_treeWeight, "weight/D" );
+  tree->Branch( "min"   , &m_treeMin   , "min/D"    );
+  tree->Branch( "max"   , &m_treeMax   , "max/D"    );
+  return tree;
+}
+
+/** @brief Write centroids to a tree made with MakeTree
+ *
+ *  min and max are repeated on every entry, so they
+ *  survive concatenation.
+ *
+ *  @param1 tree
+ *
+ *  @return void
+ */
+void YKAnalysis :: TDigest :: WriteToTree ( TTree* tree )
+{
+  Compress();
+  tree->SetBranchAddress( "mean"  , &m_treeMean   );
+  tree->SetBranchAddress( "weight", &m_treeWeight );
+  tree->SetBranchAddress( "min"   , &m_treeMin    );
+  tree->SetBranchAddress( "max"   , &m_treeMax    );
+  m_treeMin = m_min;
+  m_treeMax = m_max;
+  for( auto& c : m_v_centroids ){
+    m_treeMean   = c.mean;
+    m_treeWeight = c.weight;
+    tree->Fill();
+  }
+}
+
+/** @brief Add all centroids of a tree
+ *
+ *  @param1 tree, e.g. several hadd'ed outputs
+ *
+ *  @return false if tree has no centroid branches
+ */
+bool YKAnalysis :: TDigest :: ReadFromTree ( TTree* tree )
+{
+  if( !tree || !tree->GetBranch( "mean" ) || !tree->GetBranch( "weight" ) ) return false;
+
+  double mean = 0, weight = 0, min = 0, max = 0;
+  bool hasMinMax = tree->GetBranch( "min" ) && tree->GetBranch( "max" );
+  tree->SetBranchAddress( "mean"  , &mean   );
+  tree->SetBranchAddress( "weight", &weight );
+  if( hasMinMax ){
+    tree->SetBranchAddress( "min", &min );
+    tree->SetBranchAddress( "max", &max );
+  }
+
+  for( Long64_t i = 0; i < tree->GetEntries(); i++ ){
+    tree->GetEntry( i );
+    if( !( weight > 0 ) ) continue;
+    m_v_buffer.push_back( Centroid{ mean, weight } );
+    m_totalWeight += weight;
+    m_min = std::min( m_min, hasMinMax ? min : mean );
+    m_max = std::max( m_max, hasMinMax ? max : mean );
+    if( m_v_buffer.size() >= m_bufferSize ) Compress();
+  }
+  tree->ResetBranchAddresses();
+  Compress();
+  return true;
+}
+
+/** @brief Print summary
+ *
+ *  @param1 Name of caller
+ *
+ *  @return void
+ */
+void YKAnalysis :: TDigest :: Print ( const std::string& caller )
+{
+  std::cout << caller << " : TDigest " << m_totalWeight << " entries in "
+	    << GetNCentroids() << " centroids, median " << Quantile( 0.5 )
+	    << " [" << m_min << ", " << m_max << "]" << std::endl;
+}
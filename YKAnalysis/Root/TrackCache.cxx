@@ -0,0 +1,133 @@
+/** @file TrackCache.cxx
+ *  @brief Implementation of TrackCache.
+ *
+ *  TrackCache holds the tracks of the current event
+ *  as compact arrays of pt, eta, phi and quality flags.
+ *  It is filled once per event by the first analysis that
+ *  asks for it, which is also when the track selection tool
+ *  is run, once per track. SharedData clears it at the end
+ *  of every event. Storage is kept between events.
+ *
+ *  @author Yakov Kulinich
+ *  @bug No known bugs.
+ */
+
+#include "YKAnalysis/TrackCache.h"
+
+#include <xAODTracking/TrackParticleContainer.h>
+#include <xAODTracking/VertexContainer.h>
+#include <InDetTrackSelectionTool/IInDetTrackSelectionTool.h>
+
+#include <cmath>
+
+/** @brief Default Constructor for TrackCache.
+ */
+YKAnalysis :: TrackCache :: TrackCache ()
+  : TrackCache( "InDetTrackParticles" )
+{}
+
+/** @brief Constructor for TrackCache.
+ *
+ *  @param1 Name of track container
+ */
+YKAnalysis :: TrackCache :: TrackCache ( const std::string& containerName )
+  : m_containerName( containerName ),
+    m_selectionTool( NULL ),
+    m_isFilled     ( false )
+{}
+
+/** @brief Destructor for TrackCache.
+ */
+YKAnalysis :: TrackCache :: ~TrackCache ()
+{}
+
+/** @brief Fill cache for this event
+ *
+ *  Does nothing if already filled this event.
+ *  The selection tool (if set) is given the
+ *  primary vertex for its z0 sin(theta) cut.
+ *
+ *  @param1 Event store
+ *
+ *  @return xAOD::TReturnCode
+ */
+xAOD::TReturnCode YKAnalysis :: TrackCache :: Retrieve ( xAOD::TEvent* eventStore )
+{
+  if( m_isFilled ) return xAOD::TReturnCode::kSuccess;
+
+  const xAOD::TrackParticleContainer* tracks = 0;
+  if( !eventStore->retrieve( tracks, m_containerName ).isSuccess() )
+    return xAOD::TReturnCode::kFailure;
+
+  const xAOD::Vertex* primaryVertex = 0;
+  if( m_selectionTool ){
+    const xAOD::VertexContainer* vertices = 0;
+    if( !eventStore->retrieve( vertices, "PrimaryVertices" ).isSuccess() )
+      return xAOD::TReturnCode::kFailure;
+    for( const auto* vertex : *vertices ){
+      if( vertex->vertexType() == xAOD::VxType::PriVtx ){ primaryVertex = vertex; break; }
+    }
+  }
+
+  std::size_t n = tracks->size();
+  m_pt     .resize( n );
+  m_eta    .resize( n );
+  m_phi    .resize( n );
+  m_quality.resize( n );
+
+  std::size_t i = 0;
+  for( const auto* trk : *tracks ){
+    m_pt [i] = trk->pt ();
+    m_eta[i] = trk->eta();
+    m_phi[i] = trk->phi();
+
+    unsigned char quality = 0;
+    if( std::fabs( m_eta[i] ) < 2.5 ) quality |= kAcceptance;
+    if( m_selectionTool && m_selectionTool->accept( *trk, primaryVertex ) ) quality |= kSelected;
+    m_quality[i] = quality;
+    i++;
+  }
+
+  m_isFilled = true;
+  return xAOD::TReturnCode::kSuccess;
+}
+
+/** @brief Clear cache
+ *
+ *  Keeps capacity.
+ *
+ *  @return void
+ */
+void YKAnalysis :: TrackCache :: Clear ()
+{
+  m_pt     .clear();
+  m_eta    .clear();
+  m_phi    .clear();
+  m_quality.clear();
+  m_isFilled = false;
+}
+
+/** @brief Copy out tracks with all given quality bits
+ *
+ *  @param1 required quality bits
+ *  @param2 output eta
+ *  @param3 output phi
+ *  @param4 output pt
+ *
+ *  @return void
+ */
+void YKAnalysis :: TrackCache :: Select ( unsigned char mask,
+					  std::vector< float >& v_eta,
+					  std::vector< float >& v_phi,
+					  std::vector< float >& v_pt ) const
+{
+  v_eta.clear();
+  v_phi.clear();
+  v_pt .clear();
+  for( std::size_t i = 0; i < m_quality.size(); i++ ){
+    if( ( m_quality[i] & mask ) != mask ) continue;
+    v_eta.push_back( m_eta[i] );
+    v_phi.push_back( m_phi[i] );
+    v_pt .push_back( m_pt [i] );
+  }
+}
@@ -36,12 +36,19 @@ namespace YKAnalysis{
     virtual xAOD::TReturnCode Finalize       () = 0;
     virtual xAOD::TReturnCode HistFinalize   () = 0;
 
-    void  RegisterSharedData ( SharedData* sd ) { m_sd = sd; }
+    // before histograms are written at an autosave,
+    // for analyses that buffer fills (AddAutoSaveListener)
+    virtual void OnAutoSave () {}
+
+    // also picks up which output tree this analysis writes to
+    void  RegisterSharedData ( SharedData* sd ) 
+    { m_sd = sd; m_outputTreeName = sd->GetOutputStream( m_analysisName ); }
    
     const std::string& GetAnalysisName() const { return m_analysisName; }
 
   protected:
     std::string m_analysisName ;
+    std::string m_outputTreeName ;
 
     SharedData* m_sd;
   };
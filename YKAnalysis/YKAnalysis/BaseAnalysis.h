@@ -14,8 +14,6 @@
 #include "YKAnalysis/Global.h"
 #include "YKAnalysis/Analysis.h"
 
-#include <GoodRunsLists/GoodRunsListSelectionTool.h>
-
 #include "TrigConfxAOD/xAODConfigTool.h"
 #include "TrigDecisionTool/TrigDecisionTool.h"
 
@@ -23,6 +21,8 @@ class HIJESUncertaintyProvider;
 
 namespace YKAnalysis{
   
+  class GoodRunsCache;
+
   class BaseAnalysis : public Analysis{
   public:
     BaseAnalysis();
@@ -39,6 +39,8 @@ namespace YKAnalysis{
     virtual xAOD::TReturnCode HistFinalize   ();
 
 
+    std::vector< std::string > GetGRLFiles();
+
   private:
     std::string m_grlFileName;
 
@@ -60,7 +62,7 @@ namespace YKAnalysis{
     //-----------------------
     // Tools
     //-----------------------
-    GoodRunsListSelectionTool *m_grl;             
+    GoodRunsCache             *m_grl;             
 
     // trigger tools member variables
     Trig::TrigDecisionTool    *m_trigDecisionTool; 
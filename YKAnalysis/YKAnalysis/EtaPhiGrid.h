@@ -0,0 +1,72 @@
+/** @file EtaPhiGrid.h
+ *  @brief Function prototypes for EtaPhiGrid.
+ *
+ *  This contains the prototypes and members
+ *  for EtaPhiGrid.
+ *
+ *  @author Yakov Kulinich
+ *  @bug No known bugs.
+ */
+
+#ifndef YKANALYSIS_ETAPHIGRID_H
+#define YKANALYSIS_ETAPHIGRID_H
+
+#include <vector>
+#include <cstddef>
+
+namespace YKAnalysis{
+
+  class EtaPhiGrid{
+  public:
+    EtaPhiGrid();
+    EtaPhiGrid( double, double );
+    ~EtaPhiGrid();
+
+    void Build ( const float*, const float*, const float*, std::size_t );
+    void Clear ();
+
+    // not const, they use the grid's scratch
+    void GetNear ( float, float, float, std::vector< int >& );
+
+    void SumInCones ( float, float,
+		      const std::vector< float >&,
+		      const std::vector< float >&,
+		      std::vector< double >& );
+
+    // scalar kernels for this grid, e.g. for validation
+    void SetUseSIMD ( bool useSIMD ) { m_useSIMD = useSIMD; }
+
+    std::size_t GetN     () const { return m_index.size(); }
+    int         GetNCells() const { return m_nEtaCells * m_nPhiCells; }
+
+  private:
+    int EtaCell ( float ) const;
+    int PhiCell ( float ) const;
+
+    void CellRange ( float, float, float, int&, int&, int&, int& ) const;
+
+    double m_etaMax;
+    double m_etaCellSize;
+    double m_phiCellSize;
+    int    m_nEtaCells;
+    int    m_nPhiCells;
+
+    // cell c holds entries [ m_cellStart[c], m_cellStart[c+1] )
+    std::vector< int >   m_cellStart;
+    std::vector< int >   m_cell;
+
+    // entries sorted by cell, with index into the input arrays
+    std::vector< int >   m_index;
+    std::vector< float > m_eta;
+    std::vector< float > m_phi;
+    std::vector< float > m_value;
+
+    // scratch for deltaR^2 of one cell
+    std::vector< float > m_dR2;
+
+    bool m_useSIMD;
+  };
+
+}
+
+#endif
@@ -0,0 +1,77 @@
+/** @file EventShape.h
+ *  @brief Function prototypes for EventShape.
+ *
+ *  This contains the prototypes and members
+ *  for EventShape.
+ *
+ *  @author Yakov Kulinich
+ *  @bug No known bugs.
+ */
+
+#ifndef YKANALYSIS_EVENTSHAPE_H
+#define YKANALYSIS_EVENTSHAPE_H
+
+#include <xAODRootAccess/TEvent.h>
+#include <xAODRootAccess/tools/TReturnCode.h>
+
+#include <string>
+
+namespace YKAnalysis{
+
+  class EventShape{
+  public:
+    // eta side of a slice, by sign of its center
+    enum Side { kC = 0, kA = 1 };
+
+    static const int kNLayers    = 24;  // CaloSampling 0..23
+    static const int kNHarmonics = 7;   // etCos/etSin, n = 1..7
+    static const int kFCalFirstLayer = 21;  // FCal0
+    static const int kFCalLastLayer  = 23;  // FCal2
+
+    EventShape();
+    EventShape( const std::string& );
+    ~EventShape();
+
+    // We do not want any copies of this class
+    EventShape           ( const EventShape& ) = delete ;
+    EventShape& operator=( const EventShape& ) = delete ;
+
+    xAOD::TReturnCode Retrieve ( xAOD::TEvent* );
+    void              Clear    ();
+
+    bool IsFilled () const { return m_isFilled; }
+
+    // MeV
+    double GetEt    ( int layer, int side ) const { return m_et[ layer ][ side ]; }
+    double GetEt    ( int layer ) const { return m_et[ layer ][ kC ] + m_et[ layer ][ kA ]; }
+    // harmonic n = 1..kNHarmonics
+    double GetEtCos ( int layer, int side, int n ) const { return m_etCos[ layer ][ side ][ n - 1 ]; }
+    double GetEtSin ( int layer, int side, int n ) const { return m_etSin[ layer ][ side ][ n - 1 ]; }
+
+    // FCal, layers 21-23, MeV
+    double GetFCalEt    ( int side ) const { return m_fcalEt[ side ]; }
+    double GetFCalEt    () const { return m_fcalEt[ kC ] + m_fcalEt[ kA ]; }
+    double GetFCalEtCos ( int side, int n ) const { return m_fcalEtCos[ side ][ n - 1 ]; }
+    double GetFCalEtSin ( int side, int n ) const { return m_fcalEtSin[ side ][ n - 1 ]; }
+
+  private:
+    void Zero ();
+
+    std::string m_containerName;
+
+    bool m_isFilled;
+
+    // [layer][side]
+    double m_et   [ kNLayers ][ 2 ];
+    double m_etCos[ kNLayers ][ 2 ][ kNHarmonics ];
+    double m_etSin[ kNLayers ][ 2 ][ kNHarmonics ];
+
+    // [side]
+    double m_fcalEt   [ 2 ];
+    double m_fcalEtCos[ 2 ][ kNHarmonics ];
+    double m_fcalEtSin[ 2 ][ kNHarmonics ];
+  };
+
+}
+
+#endif
@@ -0,0 +1,100 @@
+/** @file GoodRunsCache.h
+ *  @brief Function prototypes for GoodRunsCache.
+ *
+ *  This contains the prototypes and members
+ *  for GoodRunsCache.
+ *
+ *  @author Yakov Kulinich
+ *  @bug No known bugs.
+ */
+
+#ifndef YKANALYSIS_GOODRUNSCACHE_H
+#define YKANALYSIS_GOODRUNSCACHE_H
+
+#include <Rtypes.h>
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include <stdint.h>
+
+namespace YKAnalysis{
+
+  class GoodRunsCache{
+  public:
+    GoodRunsCache();
+    ~GoodRunsCache();
+
+    // We do not want any copies of this class
+    GoodRunsCache           ( const GoodRunsCache& ) = delete ;
+    GoodRunsCache& operator=( const GoodRunsCache& ) = delete ;
+
+    bool Initialize ( const std::vector< std::string >&, const std::string& );
+
+    inline bool PassRunLB ( int, int ) const;
+
+    int  GetNRuns      () const { return m_m_runs.size(); }
+    int  GetNIntervals () const { return m_v_intervals.size(); }
+
+  private:
+    // one good lumi block range, inclusive
+    struct Interval { int32_t run; int32_t lbBegin; int32_t lbEnd; };
+
+    // identifies the xml a cache was built from
+    struct Source   { std::string path; Long64_t size; Long64_t mtime; };
+
+    // where a run lives in the bitmap, lumi blocks
+    // from openFrom on are good without a bit
+    struct RunEntry { uint64_t offset; int32_t nLB; int32_t openFrom; };
+
+    bool ReadSources ( const std::vector< std::string >& );
+    bool ReadCache   ( const std::string& );
+    bool WriteCache  ( const std::string& ) const;
+    bool ReadXML     ();
+    void BuildBitmap ();
+
+    std::vector< Source   > m_v_sources;
+    std::vector< Interval > m_v_intervals;
+
+    std::unordered_map< int, RunEntry > m_m_runs;
+    std::vector< uint64_t >             m_bits;
+
+    // runs rarely change from event to event
+    mutable int      m_lastRun;
+    mutable RunEntry m_lastEntry;
+
+    static const char     s_magic[8];
+    static const uint32_t s_version;
+
+    // ranges ending beyond this are open-ended
+    static const int32_t  s_maxLB;
+  };
+
+}
+
+/** @brief Check if run, lumi block is good
+ *
+ *  One hash lookup when the run changes,
+ *  otherwise a single bit test.
+ *
+ *  @param1 run number
+ *  @param2 lumi block
+ *
+ *  @return true if good
+ */
+inline bool YKAnalysis :: GoodRunsCache :: PassRunLB( int run, int lb ) const
+{
+  if( run != m_lastRun ){
+    auto itr = m_m_runs.find( run );
+    m_lastRun   = run;
+    m_lastEntry = itr != m_m_runs.end() ? itr->second : RunEntry{ 0, 0, INT32_MAX };
+  }
+  if( lb < 0 ) return false;
+  if( lb >= m_lastEntry.openFrom ) return true;
+  if( lb >= m_lastEntry.nLB ) return false;
+  uint64_t bit = m_lastEntry.offset + lb;
+  return ( m_bits[ bit >> 6 ] >> ( bit & 63 ) ) & 1;
+}
+
+#endif
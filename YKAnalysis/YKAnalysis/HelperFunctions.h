@@ -19,6 +19,7 @@
 #include "TRandom3.h"
 #include "TObjArray.h"
 #include "TObjString.h"
+#include "TStopwatch.h"
 
 static const float GeV = 1000.;
 
@@ -38,4 +39,6 @@ std::vector<std::string> vectorise(TString str, TString sep=" ");
 std::vector<double> vectoriseD(TString str, TString sep=" ");
 std::vector<double> makeUniformVec(int N, double min, double max);
 
+void printInitTime(const std::string& caller, const std::string& tool, TStopwatch& sw);
+
 #endif
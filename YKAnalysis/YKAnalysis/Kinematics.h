@@ -0,0 +1,44 @@
+/** @file Kinematics.h
+ *  @brief Function prototypes for Kinematics.
+ *
+ *  This contains the prototypes for batch
+ *  eta-phi kinematics kernels. One reference
+ *  against many candidates given as arrays.
+ *
+ *  @author Yakov Kulinich
+ *  @bug No known bugs.
+ */
+
+#ifndef YKANALYSIS_KINEMATICS_H
+#define YKANALYSIS_KINEMATICS_H
+
+#include <cstddef>
+
+namespace YKAnalysis{
+
+  namespace Kinematics{
+
+    // single pair
+    float DeltaPhi ( float, float );
+    float DeltaR2  ( float, float, float, float );
+    float DeltaR   ( float, float, float, float );
+
+    // one reference against n candidates, last argument
+    // false forces the scalar kernels, e.g. for validation
+    void  DeltaPhiBatch ( float, const float*, std::size_t, float*, bool useSIMD = true );
+    void  DeltaR2Batch  ( float, float, const float*, const float*, std::size_t, float*,
+			  bool useSIMD = true );
+    std::size_t ConeMask( float, float, float, const float*, const float*, std::size_t, unsigned char*,
+			  bool useSIMD = true );
+
+    // SIMD is chosen at build time (SSE2 unless
+    // YKANALYSIS_NO_SIMD is defined). Callers keep their
+    // own switch and pass it to the kernels
+    bool        HaveSIMD ();
+    const char* Backend  ( bool useSIMD = true );
+
+  }
+
+}
+
+#endif
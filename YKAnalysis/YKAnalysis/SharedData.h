@@ -18,14 +18,21 @@
 #include <TFile.h>
 #include <TH1.h>
 #include <TTree.h>
+#include <TBranch.h>
 #include <TVector3.h>
 #include <TLorentzVector.h>
 
 #include <iostream>
 #include <string>
+#include <vector>
+#include <map>
 
 namespace YKAnalysis{
   
+  class TrackCache;
+  class EventShape;
+  class Analysis;
+
   class SharedData{
     
   public:
@@ -43,8 +50,18 @@ namespace YKAnalysis{
     xAOD::TEvent* GetEventStore () { return m_eventStore; };  
  
     template<class T> 
-    void   AddOutputToTree    ( const std::string&, T*);
+    void   AddOutputToTree    ( const std::string&, T*, const std::string& = "" );
+    TBranch* AddOutputArrayToTree ( const std::string&, void*, const std::string&, 
+				    const std::string& = "" );
     void   AddOutputHistogram ( TH1* );
+    void   AddOutputObject    ( TObject* );
+
+    TTree* AddOutputTree      ( const std::string&, const std::string& = "", int = -1 );
+
+    // told before histograms are written at autosave
+    void   AddAutoSaveListener ( Analysis* );
+    TTree* GetOutputTree      ( const std::string& = "" );
+    std::string GetOutputStream ( const std::string& );
    
     int    GetEventCounter    () { return m_eventCounter; }
 
@@ -52,6 +69,16 @@ namespace YKAnalysis{
 
     TH1*   GetEventStatistics () { return m_hEventStatistics; }
 
+    TrackCache* GetTrackCache () { return m_trackCache; }
+    EventShape* GetEventShape () { return m_eventShape; }
+
+    // FCal sum Et (TeV), 0 until the event shape is retrieved
+    double GetFCalEt () const;
+
+    // bytes filled into output baskets not yet written to file,
+    // main tree and streams
+    Long64_t GetOutputBufferSize () const;
+
     void   EndOfEvent       ( bool );
 
     bool   DoPrint          ();
@@ -70,9 +97,31 @@ namespace YKAnalysis{
     TTree*        m_tree;
     TEnv*         m_config;
 
-    std::vector< TH1* > m_v_hists;
+    // histograms and other output objects
+    std::vector< TObject* > m_v_hists;
+
+    // get OnAutoSave, not owned
+    std::vector< Analysis* > m_v_autoSaveListeners;
+
+    // additional output streams, friends of m_tree
+    std::vector< TTree* >          m_v_streamTrees;
+    std::vector< TFile* >          m_v_streamFiles;
+    std::map< std::string, int >   m_m_streamCompression;
 
     TH1*          m_hEventStatistics;
+
+    // per event caches, cleared in EndOfEvent
+    TrackCache*   m_trackCache;
+    EventShape*   m_eventShape;
+
+    // output memory policy (bytes, 0 = ROOT default)
+    Long64_t      m_outputFlushBytes;
+    Long64_t      m_outputAutoSaveBytes;
+    // of main tree at last autosave
+    Long64_t      m_savedBytes;
+
+    void          SetOutputPolicy  ( TTree* );
+    void          AutoSaveOutput   ();
   };
 
 }
@@ -81,13 +130,20 @@ namespace YKAnalysis{
  *
  *  @param1 Name of branch
  *  @param2 Pointer to object
+ *  @param3 Name of output tree (default is main tree)
  *
  *  @return void
  */
 template<class T> 
-void YKAnalysis :: SharedData :: AddOutputToTree( const std::string& name, T* pObj ){
-  std::cout << "Adding " << name << std::endl;
-  m_tree->Branch( name.c_str(), pObj );
+void YKAnalysis :: SharedData :: AddOutputToTree( const std::string& name, T* pObj,
+						  const std::string& treeName ){
+  TTree* tree = GetOutputTree( treeName );
+  std::cout << "Adding " << name << " to " << tree->GetName() << std::endl;
+  TBranch* branch = tree->Branch( name.c_str(), pObj );
+
+  auto itr = m_m_streamCompression.find( tree->GetName() );
+  if( branch && itr != m_m_streamCompression.end() )
+    { branch->SetCompressionSettings( itr->second ); }
 }
 
 #endif
@@ -0,0 +1,78 @@
+/** @file TDigest.h
+ *  @brief Function prototypes for TDigest.
+ *
+ *  This contains the prototypes and members
+ *  for TDigest.
+ *
+ *  @author Yakov Kulinich
+ *  @bug No known bugs.
+ */
+
+#ifndef YKANALYSIS_TDIGEST_H
+#define YKANALYSIS_TDIGEST_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+class TTree;
+
+namespace YKAnalysis{
+
+  class TDigest{
+  public:
+    TDigest();
+    TDigest( double );
+    ~TDigest();
+
+    // We do not want any copies of this class
+    TDigest           ( const TDigest& ) = delete ;
+    TDigest& operator=( const TDigest& ) = delete ;
+
+    void Add   ( double, double w = 1 );
+    void Merge ( const TDigest& );
+
+    double Quantile ( double );
+
+    double GetTotalWeight () const { return m_totalWeight; }
+    double GetMin         () const { return m_min; }
+    double GetMax         () const { return m_max; }
+    std::size_t GetNCentroids ();
+
+    // one entry per centroid, trees of several jobs can be
+    // concatenated (hadd) and read back as one digest
+    TTree* MakeTree ( const std::string& );
+    void   WriteToTree  ( TTree* );
+    bool   ReadFromTree ( TTree* );
+
+    void Print ( const std::string& );
+
+  private:
+    struct Centroid{
+      double mean;
+      double weight;
+      bool operator<( const Centroid& other ) const { return mean < other.mean; }
+    };
+
+    void Compress ();
+
+    double m_compression;
+
+    std::vector< Centroid > m_v_centroids;
+    // unmerged points, merged when full
+    std::vector< Centroid > m_v_buffer;
+    std::size_t             m_bufferSize;
+
+    // scratch for Compress
+    std::vector< Centroid > m_v_merge;
+
+    double m_totalWeight;
+    double m_min, m_max;
+
+    // for WriteToTree
+    double m_treeMean, m_treeWeight, m_treeMin, m_treeMax;
+  };
+
+}
+
+#endif
@@ -0,0 +1,75 @@
+/** @file TrackCache.h
+ *  @brief Function prototypes for TrackCache.
+ *
+ *  This contains the prototypes and members
+ *  for TrackCache.
+ *
+ *  @author Yakov Kulinich
+ *  @bug No known bugs.
+ */
+
+#ifndef YKANALYSIS_TRACKCACHE_H
+#define YKANALYSIS_TRACKCACHE_H
+
+#include <xAODRootAccess/TEvent.h>
+#include <xAODRootAccess/tools/TReturnCode.h>
+
+#include <string>
+#include <vector>
+
+namespace InDet{
+  class IInDetTrackSelectionTool;
+}
+
+namespace YKAnalysis{
+
+  class TrackCache{
+  public:
+    // quality flags, one bit each
+    enum Quality { kAcceptance = 1 << 0,  // |eta| < 2.5
+		   kSelected   = 1 << 1 }; // passed selection tool
+
+    TrackCache();
+    TrackCache( const std::string& );
+    ~TrackCache();
+
+    // We do not want any copies of this class
+    TrackCache           ( const TrackCache& ) = delete ;
+    TrackCache& operator=( const TrackCache& ) = delete ;
+
+    void SetSelectionTool ( InDet::IInDetTrackSelectionTool* tool ) { m_selectionTool = tool; }
+    bool HasSelectionTool () const { return m_selectionTool != NULL; }
+
+    xAOD::TReturnCode Retrieve ( xAOD::TEvent* );
+    void              Clear    ();
+
+    void Select ( unsigned char,
+		  std::vector< float >&,
+		  std::vector< float >&,
+		  std::vector< float >& ) const;
+
+    bool IsFilled () const { return m_isFilled; }
+
+    std::size_t          GetN       () const { return m_pt.size(); }
+    const float*         GetPt      () const { return m_pt.data();  }
+    const float*         GetEta     () const { return m_eta.data(); }
+    const float*         GetPhi     () const { return m_phi.data(); }
+    const unsigned char* GetQuality () const { return m_quality.data(); }
+
+  private:
+    std::string m_containerName;
+
+    // not owned
+    InDet::IInDetTrackSelectionTool* m_selectionTool;
+
+    bool m_isFilled;
+
+    std::vector< float >         m_pt;
+    std::vector< float >         m_eta;
+    std::vector< float >         m_phi;
+    std::vector< unsigned char > m_quality;
+  };
+
+}
+
+#endif
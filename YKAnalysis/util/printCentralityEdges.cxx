@@ -0,0 +1,94 @@
+/** @file printCentralityEdges.cxx
+ *  @brief Print FCalEt centrality edges from t-digest trees
+ *
+ *  Reads the fcalEtDigest tree (see TDigest) of one or
+ *  more output files, e.g. hadd'ed outputs of all jobs,
+ *  merges the centroids into one digest and prints the
+ *  FCalEt at the given centrality percentiles. Centrality
+ *  c% is the c% of events with the largest FCalEt.
+ *  Edges are printed ascending in FCalEt, ready for
+ *  fluctuationFCalEtClasses: the lowest edge is
+ *  min( 0, smallest FCalEt ), so the most peripheral
+ *  events are in the first class, and the top edge is
+ *  the open edge given with -t (TeV), above all events,
+ *  instead of the largest FCalEt.
+ *
+ *  Usage: printCentralityEdges file.root [file2.root ...]
+ *                              [-c "0 10 20 30 40 60 80"] [-t 15.0]
+ *
+ *  @author Yakov Kulinich
+ *  @bug No known bugs.
+ */
+
+#include "YKAnalysis/TDigest.h"
+
+#include <TChain.h>
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+
+int main( int argc, char* argv[] ){
+
+  std::string percentiles = "0 1 5 10 20 30 40 50 60 70 80";
+  std::string treeName    = "fcalEtDigest";
+  double      topEdge     = 15.0;
+
+  TChain chain( treeName.c_str() );
+  int nFiles = 0;
+  for( int i = 1; i < argc; i++ ){
+    std::string arg = argv[i];
+    if( arg == "-c" && i + 1 < argc ){ percentiles = argv[++i]; continue; }
+    if( arg == "-t" && i + 1 < argc ){ topEdge = std::atof( argv[++i] ); continue; }
+    chain.Add( arg.c_str() );
+    nFiles++;
+  }
+  
+  if( !nFiles ){
+    std::cerr << "Usage: printCentralityEdges file.root [file2.root ...] [-c \"0 10 20 ...\"] [-t 15.0]" << std::endl;
+    return 1;
+  }
+
+  YKAnalysis::TDigest digest;
+  if( !digest.ReadFromTree( &chain ) || !digest.GetTotalWeight() ){
+    std::cerr << "printCentralityEdges : no " << treeName << " centroids found" << std::endl;
+    return 1;
+  }
+  digest.Print( "printCentralityEdges" );
+
+  if( !( topEdge > digest.GetMax() ) ){
+    std::cerr << "printCentralityEdges : top edge " << topEdge
+	      << " TeV is not above the largest FCalEt " << digest.GetMax() << std::endl;
+    return 1;
+  }
+
+  // 0% and 100% are always the outer edges
+  std::vector< double > v_percentiles;
+  std::stringstream ss( percentiles );
+  double c;
+  while( ss >> c ){
+    if( c > 0 && c < 100 ) v_percentiles.push_back( c );
+  }
+  v_percentiles.push_back( 0   );
+  v_percentiles.push_back( 100 );
+  // most peripheral first, so edges ascend
+  std::sort( v_percentiles.rbegin(), v_percentiles.rend() );
+  v_percentiles.erase( std::unique( v_percentiles.begin(), v_percentiles.end() ),
+		       v_percentiles.end() );
+
+  std::stringstream edges;
+  for( auto& cent : v_percentiles ){
+    double edge;
+    if     ( cent == 100 ) edge = std::min( 0., digest.GetMin() );
+    else if( cent == 0   ) edge = topEdge;
+    else                   edge = digest.Quantile( 1 - cent / 100 );
+    std::cout << " " << cent << "% : FCalEt = " << edge << std::endl;
+    edges << ( edges.tellp() > 0 ? " " : "" ) << edge;
+  }
+  std::cout << "fluctuationFCalEtClasses: " << edges.str() << std::endl;
+  
+  return 0;
+}